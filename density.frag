@@ -0,0 +1,36 @@
+#version 450
+layout(location = 0) in vec2 cell;
+layout(location = 0) out vec4 fs_color;
+
+layout(std430, set = 0, binding = 0) readonly buffer Bins {
+  uint most;
+  uint counts[];
+};
+
+// after the part of the push constants the vertex shaders use
+layout(push_constant) uniform PerDraw {
+  layout(offset = 104) int colormap;
+  int bins_x;
+  int bins_y;
+  int log_scale;
+};
+
+// evenly spaced stops, in the order of the colormap enum
+const vec3 stops[3][5] = vec3[][](
+  vec3[](vec3(0.85), vec3(0.64), vec3(0.43), vec3(0.21), vec3(0)),
+  vec3[](vec3(0.5, 0, 0), vec3(0.9, 0.1, 0), vec3(1, 0.5, 0), vec3(1, 0.85, 0.1), vec3(1, 1, 0.6)),
+  vec3[](vec3(0.267, 0.005, 0.329), vec3(0.229, 0.322, 0.546), vec3(0.128, 0.567, 0.551), vec3(0.369, 0.789, 0.383), vec3(0.993, 0.906, 0.144))
+);
+
+void main() {
+  ivec2 c = min(ivec2(cell * vec2(bins_x, bins_y)), ivec2(bins_x - 1, bins_y - 1));
+  uint n = counts[c.y * bins_x + c.x];
+  // empty bins leave the background alone
+  if(n == 0)
+    discard;
+
+  float t = log_scale != 0 ? log(float(n)) / log(float(max(most, 2))) : float(n) / float(most);
+  float s = clamp(t, 0, 1) * 4;
+  int i = min(int(s), 3);
+  fs_color = vec4(mix(stops[colormap][i], stops[colormap][i + 1], s - i), 1);
+}
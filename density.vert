@@ -0,0 +1,9 @@
+#version 450
+layout(location = 0) out vec2 cell;
+
+// one triangle covering the whole screen
+void main() {
+  vec2 p = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2) * 2 - 1;
+  gl_Position = vec4(p, 0, 1);
+  cell = p * 0.5 + 0.5;
+}
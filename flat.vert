@@ -0,0 +1,23 @@
+#version 450
+layout(location = 0) in vec4 pos;
+
+layout(location = 0) out vec4 vs_color;
+
+layout(constant_id = 0) const bool points = false;
+
+// the color is constant for the whole draw
+layout(push_constant) uniform PerDraw {
+  mat4 mvp;
+  vec4 color;
+  vec2 line_size;
+  float aspect;
+  int first;
+  float point_size;
+};
+
+void main() {
+  gl_Position = mvp * pos;
+  vs_color = color;
+  if(points)
+    gl_PointSize = point_size;
+}
@@ -0,0 +1,12 @@
+#version 450
+layout(location = 0) in vec4 vs_color;
+layout(location = 1) in float vs_edge;
+layout(location = 2) flat in float vs_half_width;
+layout(location = 0) out vec4 fs_color;
+
+// coverage of the pixel by the line from how far its center is from the
+// line's edge, lines thinner than a pixel are fainter instead
+void main() {
+  float coverage = clamp(vs_half_width + 0.5 - abs(vs_edge), 0, 1) * min(2 * vs_half_width, 1);
+  fs_color = vec4(vs_color.rgb, vs_color.a * coverage);
+}
@@ -0,0 +1,84 @@
+#version 450
+layout(std430, set = 0, binding = 0) readonly buffer Points {
+  vec2 points[];
+};
+
+layout(location = 0) out vec4 vs_color;
+// pixels from the middle of the line and half its width, for smooth lines
+layout(location = 1) out float vs_edge;
+layout(location = 2) flat out float vs_half_width;
+
+// without msaa the quads get a pixel of fringe each side and the fragment
+// shader fades the edges out by distance instead
+layout(constant_id = 1) const bool smooth_lines = false;
+
+layout(push_constant) uniform PerDraw {
+  mat4 mvp;
+  vec4 color;
+  vec2 line_size;
+  float aspect;
+  int first;
+  float point_size;
+  float line_width;
+};
+
+// Every segment is a quad of 6 vertices, x is the end of the segment and y
+// the side of the line. Where two segments meet both quads end on the same
+// mitered edge, so they don't overlap and smooth lines don't get blended
+// twice at the joins
+const ivec2 corners[6] = ivec2[](
+  ivec2(0, -1), ivec2(1, -1), ivec2(1, +1),
+  ivec2(0, -1), ivec2(1, +1), ivec2(0, +1)
+);
+
+// sharper turns than this many half widths of miter get cut short
+const float miter_limit = 4;
+
+vec4 project(int i) {
+  return mvp * vec4(points[i], 0, 1);
+}
+
+// in pixels, line_size takes it back to clip space
+vec2 segment_normal(vec4 s0, vec4 s1) {
+  vec2 tangent = vec2(s1.x - s0.x, (s1.y - s0.y) / aspect);
+  float len = length(tangent);
+  tangent = len > 0 ? tangent / len : vec2(1, 0);
+  return vec2(-tangent.y, tangent.x);
+}
+
+// the corner where segments with normals a and b meet, the same whichever
+// of the two asks. both sides stay a half width from the middle of both
+vec2 miter(vec2 a, vec2 b) {
+  vec2 m = a + b;
+  float len = length(m);
+  if(len < 1e-6)
+    return a;
+  m /= len;
+  return m / max(dot(m, a), 1 / miter_limit);
+}
+
+void main() {
+  // firstVertex picks the first segment drawn, and the instance is the last
+  // point of the whole strip so a part of it joins up like the rest
+  int segment = gl_VertexIndex / 6;
+  ivec2 corner = corners[gl_VertexIndex % 6];
+  int i = first + segment;
+
+  vec4 s0 = project(i);
+  vec4 s1 = project(i + 1);
+
+  vec2 normal = segment_normal(s0, s1);
+  vec2 offset = normal;
+  if(corner.x == 0 && i > first)
+    offset = miter(segment_normal(project(i - 1), s0), normal);
+  else if(corner.x == 1 && i + 1 < gl_InstanceIndex)
+    offset = miter(normal, segment_normal(s1, project(i + 2)));
+
+  gl_Position = (corner.x == 0 ? s0 : s1) + vec4(corner.y * offset * line_size, 0, 0);
+  vs_color = color;
+  if(smooth_lines) {
+    // line_size already has the fringe in it
+    vs_half_width = line_width / 2;
+    vs_edge = corner.y * (vs_half_width + 1);
+  }
+}
@@ -68,7 +68,7 @@ int main(int argc, char ** argv)
     fprintf(stderr, "failed to init\n");
     return 1;
   }
-  VGWindow * wind = VG_CreateWindow(800, 600);
+  VGWindow * wind = VG_CreateWindow(800, 600, 16);
   if(!wind) {
     fprintf(stderr, "failed to make window\n");
     return 1;
@@ -82,13 +82,13 @@ int main(int argc, char ** argv)
     return 1;
   }
 
-  VkCommandBuffer command_buf[2];
+  VkCommandBuffer command_buf[VG_MAX_FRAMES];
   {
     VkCommandBufferAllocateInfo createInfo = {
       .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
       .commandPool = wind->commandpool,
       .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-      .commandBufferCount = 2,
+      .commandBufferCount = VG_MAX_FRAMES,
     };
     if(vkAllocateCommandBuffers(wind->device, &createInfo, command_buf) != VK_SUCCESS) {
       fprintf(stderr, "failed to create command pool\n");
@@ -97,11 +97,15 @@ int main(int argc, char ** argv)
   }
 
   OldskoolContext * osk = osCreate(wind);
+  // the geometry never changes, it's recorded once and replayed each frame
+  // under that frame's matrices
+  OldskoolList * background = osCreateList(osk);
+  OldskoolList * square = osCreateList(osk);
+  bool recorded = false;
 
   bool running = true;
   bool minimized = false;
 
-  bool frame_parity = false;
   while(running) {
     SDL_Event windowEvent;
     bool resize_event = false;
@@ -153,14 +157,14 @@ int main(int argc, char ** argv)
       continue;
     }
 
-    vkWaitForFences(wind->device, 1, &wind->frame_fence[frame_parity], VK_TRUE, UINT64_MAX);
+    uint32_t slot = VG_NextFrame(wind);
 
     Globals globals;
     WriteGlobals((char*)&globals, wind->swap_extent);
 
     uint32_t image_index;
     {
-      VkResult ret = vkAcquireNextImageKHR(wind->device, wind->swapchain, UINT64_MAX, wind->image_available[frame_parity], VK_NULL_HANDLE, &image_index);
+      VkResult ret = vkAcquireNextImageKHR(wind->device, wind->swapchain, UINT64_MAX, wind->image_available[slot], VK_NULL_HANDLE, &image_index);
       if(ret == VK_ERROR_OUT_OF_DATE_KHR) {
         if(VG_RecreateSwapchain(wind)) {
           fprintf(stderr, "failed to resize window\n");
@@ -174,19 +178,19 @@ int main(int argc, char ** argv)
       }
     }
 
-    vkResetFences(wind->device, 1, &wind->frame_fence[frame_parity]);
-
     {
       VkCommandBufferBeginInfo beginfo = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
         .flags = 0,
         .pInheritanceInfo = NULL,
       };
-      if(vkBeginCommandBuffer(command_buf[frame_parity], &beginfo) != VK_SUCCESS) {
+      if(vkBeginCommandBuffer(command_buf[slot], &beginfo) != VK_SUCCESS) {
         fprintf(stderr, "failed to begin command recording\n");
         return 1;
       }
 
+      osUploadBuffers(osk, command_buf[slot]);
+
       VkImageMemoryBarrier image_barrier = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
         .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
@@ -201,7 +205,7 @@ int main(int argc, char ** argv)
         },
       };
 
-      vkCmdPipelineBarrier(command_buf[frame_parity],
+      vkCmdPipelineBarrier(command_buf[slot],
         VK_PIPELINE_STAGE_TRANSFER_BIT,
         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
         0,
@@ -219,9 +223,9 @@ int main(int argc, char ** argv)
         .clearValueCount = 0,
         .pClearValues = NULL,
       };
-      vkCmdBeginRenderPass(command_buf[frame_parity], &rpinfo, VK_SUBPASS_CONTENTS_INLINE);
+      vkCmdBeginRenderPass(command_buf[slot], &rpinfo, VK_SUBPASS_CONTENTS_INLINE);
 
-      osReset(osk);
+      osReset(osk, slot);
 
       osClearColor(osk, make_vec4( 1, 0.5, 0.0, 1 ));
 
@@ -234,39 +238,49 @@ int main(int argc, char ** argv)
       } };
       osLoadMatrix(osk, vulkan_squish);
 
-      osBegin(osk, OS_TRIANGLES);
-        osColor3(osk, make_vec3(0, 0, 0));
-        osVertex2(osk, make_vec2(-1, -1));
-        osVertex2(osk, make_vec2(+1, -1));
-        osVertex2(osk, make_vec2(0, +1));
-      osEnd(osk);
+      if(!recorded) {
+        osNewList(osk, background);
+        osBegin(osk, OS_TRIANGLES);
+          osColor3(osk, make_vec3(0, 0, 0));
+          osVertex2(osk, make_vec2(-1, -1));
+          osVertex2(osk, make_vec2(+1, -1));
+          osVertex2(osk, make_vec2(0, +1));
+        osEnd(osk);
+        osEndList(osk);
+
+        float poses[4][2] = {
+          { -0.5, -0.5 },
+          { +0.5, -0.5 },
+          { +0.5, +0.5 },
+          { -0.5, +0.5 },
+        };
+        float colors[4][3] = {
+          { 1, 0, 0 },
+          { 0, 1, 0 },
+          { 0, 0, 1 },
+          { 1, 1, 1 },
+        };
+        unsigned indices[6] = {
+          0, 1, 2, 0, 2, 3
+        };
+        osNewList(osk, square);
+        osVertexPointer(osk, 2, OS_FLOAT, 4, 0, poses, 0);
+        osColorPointer(osk, 3, OS_FLOAT, 4, 0, colors, 0);
+        osDrawElements(osk, OS_TRIANGLES, 6, OS_UNSIGNED_INT, indices);
+        osEndList(osk);
+        recorded = true;
+      }
+
+      osCallList(osk, background);
 
       osPushMatrix(osk, globals.proj);
       osPushMatrix(osk, globals.view);
       osPushMatrix(osk, globals.model);
+      osCallList(osk, square);
 
-      float poses[4][2] = {
-        { -0.5, -0.5 },
-        { +0.5, -0.5 },
-        { +0.5, +0.5 },
-        { -0.5, +0.5 },
-      };
-      float colors[4][3] = {
-        { 1, 0, 0 },
-        { 0, 1, 0 },
-        { 0, 0, 1 },
-        { 1, 1, 1 },
-      };
-      unsigned indices[6] = {
-        0, 1, 2, 0, 2, 3
-      };
-      osVertexPointer(osk, 2, OS_FLOAT, 4, 0, poses, 0);
-      osColorPointer(osk, 3, OS_FLOAT, 4, 0, colors, 0);
-      osDrawElements(osk, OS_TRIANGLES, 6, OS_UNSIGNED_INT, indices);
+      osSubmit(osk, command_buf[slot], slot);
 
-      osSubmit(osk, command_buf[frame_parity], frame_parity);
-
-      vkCmdEndRenderPass(command_buf[frame_parity]);
+      vkCmdEndRenderPass(command_buf[slot]);
 
       {
         VkImageMemoryBarrier image_barriers[] = {
@@ -298,7 +312,7 @@ int main(int argc, char ** argv)
           },
         };
 
-        vkCmdPipelineBarrier(command_buf[frame_parity],
+        vkCmdPipelineBarrier(command_buf[slot],
           VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
           VK_PIPELINE_STAGE_TRANSFER_BIT,
           0,
@@ -321,7 +335,7 @@ int main(int argc, char ** argv)
           .extent = { wind->swap_extent.width, wind->swap_extent.height, 1 },
         };
 
-        vkCmdResolveImage(command_buf[frame_parity],
+        vkCmdResolveImage(command_buf[slot],
           wind->primary_frameimage.img,
           VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
           wind->swapimages[image_index],
@@ -331,7 +345,7 @@ int main(int argc, char ** argv)
 
         image_barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
         image_barriers[0].newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-        vkCmdPipelineBarrier(command_buf[frame_parity],
+        vkCmdPipelineBarrier(command_buf[slot],
           VK_PIPELINE_STAGE_TRANSFER_BIT,
           VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
           0,
@@ -341,29 +355,13 @@ int main(int argc, char ** argv)
         );
       }
 
-      if(vkEndCommandBuffer(command_buf[frame_parity]) != VK_SUCCESS) {
+      if(vkEndCommandBuffer(command_buf[slot]) != VK_SUCCESS) {
         fprintf(stderr, "failed to end command recording\n");
         return 1;
       }
     }
 
-    VkSemaphore waitSemaphores[] = { wind->image_available[frame_parity] };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_TRANSFER_BIT };
-    VkSemaphore signalSemaphores[] = { wind->render_finished[frame_parity] };
-    VkSubmitInfo submitInfo = {
-      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-      .waitSemaphoreCount = sizeof waitSemaphores / sizeof *waitSemaphores,
-      .pWaitSemaphores = waitSemaphores,
-      .pWaitDstStageMask = waitStages,
-
-      .commandBufferCount = 1,
-      .pCommandBuffers = &command_buf[frame_parity],
-
-      .signalSemaphoreCount = sizeof signalSemaphores / sizeof *signalSemaphores,
-      .pSignalSemaphores = signalSemaphores,
-    };
-
-    if(vkQueueSubmit(wind->graphics_queue, 1, &submitInfo, wind->frame_fence[frame_parity]) != VK_SUCCESS) {
+    if(VG_SubmitFrame(wind, slot, command_buf[slot], VK_PIPELINE_STAGE_TRANSFER_BIT)) {
       fprintf(stderr, "failed to submit command buffers\n");
       return 1;
     }
@@ -371,7 +369,7 @@ int main(int argc, char ** argv)
     VkPresentInfoKHR presentInfo = {
       .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
       .waitSemaphoreCount = 1,
-      .pWaitSemaphores = signalSemaphores,
+      .pWaitSemaphores = &wind->render_finished[slot],
 
       .swapchainCount = 1,
       .pSwapchains = &wind->swapchain,
@@ -389,13 +387,14 @@ int main(int argc, char ** argv)
         return 1;
       }
     }
-    frame_parity = !frame_parity;
   }
   
   VG_WaitIdle(wind);
-  vkResetCommandBuffer(command_buf[0], 0);
-  vkResetCommandBuffer(command_buf[1], 0);
+  for(int i = 0; i < VG_MAX_FRAMES; i++)
+    vkResetCommandBuffer(command_buf[i], 0);
 
+  osDestroyList(osk, background);
+  osDestroyList(osk, square);
   osDestroy(osk);
 
   VG_DestroyWindow(wind);
@@ -22,6 +22,7 @@
 #include <stdbool.h>
 #include <assert.h>
 #include <string.h>
+#include <math.h>
 #include "volk.h"
 #include "oldskool_graphics.h"
 #include "vanity_graphics_private.h"
@@ -29,6 +30,18 @@
 
 #include "vert.h"
 #include "frag.h"
+#include "line_vert.h"
+#include "line_frag.h"
+#include "flat_vert.h"
+#include "density_vert.h"
+#include "density_frag.h"
+#include "dense_comp.h"
+#include "strips_vert.h"
+#include "cull_comp.h"
+#include "tex_vert.h"
+#include "tex_frag.h"
+#include "scalar_frag.h"
+#include "bin_comp.h"
 
 VkShaderModule VG_CreateShaderModule(VGWindow * wind, char * code, size_t size) {
   if(size % 4)
@@ -45,21 +58,81 @@ VkShaderModule VG_CreateShaderModule(VGWindow * wind, char * code, size_t size)
   return module;
 }
 
-static VGPipeline VG_CreatePipeline(VGWindow * wind) {
+// every oldskool pipeline shares this push constant layout, so the matrix
+// survives switching between pipelines
+typedef struct OldskoolPushConstants {
+  mat4 mvp;
+  union {
+    struct {
+      vec4 color;
+      float line_size[2];
+      float aspect;
+      int first;
+    };
+    // textured quads have their corners and texture coordinates here instead
+    struct {
+      float rect[4];
+      float uv[4];
+    };
+  };
+  float point_size;
+  // unexpanded, for the edges of smooth lines
+  float line_width;
+
+  // the fragment shader's part, for the density and scalar texture shaders.
+  // range is the values at either end of a scalar texture's colormap
+  int colormap;
+  int bins[2];
+  int log_scale;
+  float range[2];
+} OldskoolPushConstants;
+
+// for the binning compute shader
+typedef struct OldskoolBinConstants {
+  mat4 mvp;
+  int bins[2];
+  int first;
+  int count;
+  // what one dense line adds to a column
+  float one;
+} OldskoolBinConstants;
+
+// for the culling compute shader, which shares the binning layout. margin
+// is how far past the screen edges a series can reach, in clip space
+typedef struct OldskoolCullConstants {
+  mat4 mvp;
+  float margin[2];
+  int first;
+  int count;
+} OldskoolCullConstants;
+
+// the vertex data is set 0, anything else comes after it
+static VGPipeline VG_CreatePipeline(VGWindow * wind, VkPipelineCache cache, VkDescriptorSetLayout set_layout, int num_sets, char * vert_code, size_t vert_size, char * frag_code, size_t frag_size, const VkPipelineVertexInputStateCreateInfo * vertexInput, VkPrimitiveTopology topology, bool smooth) {
   VGPipeline ret = { VK_NULL_HANDLE, VK_NULL_HANDLE };
   VkShaderModule vert = VK_NULL_HANDLE;
   VkShaderModule frag = VK_NULL_HANDLE;
 
-  VkPushConstantRange pushLayout = {
-    .offset = 0,
-    .size = sizeof(mat4),
-    .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+  VkPushConstantRange pushLayout[] = {
+    {
+      .offset = 0,
+      .size = offsetof(OldskoolPushConstants, colormap),
+      .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+    },
+    {
+      .offset = offsetof(OldskoolPushConstants, colormap),
+      .size = sizeof(OldskoolPushConstants) - offsetof(OldskoolPushConstants, colormap),
+      .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+    },
   };
 
+  VkDescriptorSetLayout set_layouts[] = { set_layout, set_layout };
+  assert(num_sets <= (int)(sizeof set_layouts / sizeof *set_layouts));
   VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
     .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-    .pushConstantRangeCount = 1,
-    .pPushConstantRanges = &pushLayout,
+    .setLayoutCount = num_sets,
+    .pSetLayouts = set_layouts,
+    .pushConstantRangeCount = sizeof pushLayout / sizeof *pushLayout,
+    .pPushConstantRanges = pushLayout,
   };
   VkPipelineLayout pipelineLayout;
   if(vkCreatePipelineLayout(wind->device, &pipelineLayoutInfo, NULL, &pipelineLayout) != VK_SUCCESS) {
@@ -67,19 +140,35 @@ static VGPipeline VG_CreatePipeline(VGWindow * wind) {
   }
   ret.layout = pipelineLayout;
 
-  vert = VG_CreateShaderModule(wind, _binary_vert_spv_start, _binary_vert_spv_end - _binary_vert_spv_start);
-  frag = VG_CreateShaderModule(wind, _binary_frag_spv_start, _binary_frag_spv_end - _binary_frag_spv_start);
+  vert = VG_CreateShaderModule(wind, vert_code, vert_size);
+  frag = VG_CreateShaderModule(wind, frag_code, frag_size);
   if(vert == VK_NULL_HANDLE || frag == VK_NULL_HANDLE) {
     fprintf(stderr, "failed to create shader modules\n");
     goto end;
   }
   
+  // constant 0 tells the vertex shader to write gl_PointSize, which point
+  // topologies need and everything else is better off without. constant 1
+  // has it pass along what a smooth fragment shader needs for its edges
+  VkBool32 constants[] = { topology == VK_PRIMITIVE_TOPOLOGY_POINT_LIST, smooth };
+  VkSpecializationMapEntry constantEntries[] = {
+    { .constantID = 0, .offset = 0, .size = sizeof(VkBool32) },
+    { .constantID = 1, .offset = sizeof(VkBool32), .size = sizeof(VkBool32) },
+  };
+  VkSpecializationInfo specialization = {
+    .mapEntryCount = sizeof constantEntries / sizeof *constantEntries,
+    .pMapEntries = constantEntries,
+    .dataSize = sizeof constants,
+    .pData = constants,
+  };
+
   VkPipelineShaderStageCreateInfo stages[] = {
     {
       .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
       .stage = VK_SHADER_STAGE_VERTEX_BIT,
       .module = vert,
       .pName = "main",
+      .pSpecializationInfo = &specialization,
     },
     {
       .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
@@ -99,41 +188,12 @@ static VGPipeline VG_CreatePipeline(VGWindow * wind) {
     .pDynamicStates = dynamicStates,
   };
 
-  // BEGIN YUCK //
-  VkVertexInputBindingDescription vertexBinding = {
-    .binding = 0,
-    .stride = sizeof(vec4[2]),
-    .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
-  };
-
-  VkVertexInputAttributeDescription vertexAttribs[] = {
-    {
-      .binding = 0,
-      .location = 0,
-      .format = VK_FORMAT_R32G32B32A32_SFLOAT,
-      .offset = 0,
-    },
-    {
-      .binding = 0,
-      .location = 1,
-      .format = VK_FORMAT_R32G32B32A32_SFLOAT,
-      .offset = sizeof(vec4),
-    },
-  };
-
-  VkPipelineVertexInputStateCreateInfo vertexInput = {
-    .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-    .vertexBindingDescriptionCount = 1,
-    .pVertexBindingDescriptions = &vertexBinding,
-    .vertexAttributeDescriptionCount = sizeof vertexAttribs / sizeof *vertexAttribs,
-    .pVertexAttributeDescriptions = vertexAttribs,
-  };
+  // restart is only allowed on strips without extra features
   VkPipelineInputAssemblyStateCreateInfo inputAssembly = {
     .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-    .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-    .primitiveRestartEnable = VK_FALSE,
+    .topology = topology,
+    .primitiveRestartEnable = topology == VK_PRIMITIVE_TOPOLOGY_LINE_STRIP || topology == VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
   };
-  // END YUCK //
 
   VkPipelineViewportStateCreateInfo viewportState = {
     .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
@@ -158,9 +218,16 @@ static VGPipeline VG_CreatePipeline(VGWindow * wind) {
     .rasterizationSamples = wind->msaa_samples,
   };
 
+  // smooth edges come out as coverage in alpha
   VkPipelineColorBlendAttachmentState colorBlendAttachment = {
     .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
-    .blendEnable = VK_FALSE,
+    .blendEnable = smooth,
+    .srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA,
+    .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+    .colorBlendOp = VK_BLEND_OP_ADD,
+    .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+    .dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+    .alphaBlendOp = VK_BLEND_OP_ADD,
   };
 
   VkPipelineColorBlendStateCreateInfo colorBlending = {
@@ -174,7 +241,7 @@ static VGPipeline VG_CreatePipeline(VGWindow * wind) {
     .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
     .stageCount = 2,
     .pStages = stages,
-    .pVertexInputState = &vertexInput,
+    .pVertexInputState = vertexInput,
     .pInputAssemblyState = &inputAssembly,
     .pViewportState = &viewportState,
     .pRasterizationState = &rasterizer,
@@ -189,7 +256,7 @@ static VGPipeline VG_CreatePipeline(VGWindow * wind) {
   };
 
   VkPipeline pipeline;
-  if(vkCreateGraphicsPipelines(wind->device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, NULL, &pipeline) != VK_SUCCESS) {
+  if(vkCreateGraphicsPipelines(wind->device, cache, 1, &pipelineCreateInfo, NULL, &pipeline) != VK_SUCCESS) {
     fprintf(stderr, "failed to create pipeline!\n");
     goto end;
   }
@@ -205,10 +272,61 @@ end:
   return ret;
 }
 
-typedef struct OldskoolVert {
-  vec4 pos;
-  vec4 color;
-} OldskoolVert;
+// the points to bin are set 0, the bins set 1 and anything else after that,
+// all plain storage buffers
+static VGPipeline VG_CreateComputePipeline(VGWindow * wind, VkPipelineCache cache, VkDescriptorSetLayout set_layout, int num_sets, char * code, size_t size) {
+  VGPipeline ret = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+  VkShaderModule comp = VK_NULL_HANDLE;
+
+  VkPushConstantRange pushLayout = {
+    .offset = 0,
+    .size = sizeof(OldskoolBinConstants),
+    .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+  };
+
+  VkDescriptorSetLayout set_layouts[] = { set_layout, set_layout, set_layout };
+  assert(num_sets <= (int)(sizeof set_layouts / sizeof *set_layouts));
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo = {
+    .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+    .setLayoutCount = num_sets,
+    .pSetLayouts = set_layouts,
+    .pushConstantRangeCount = 1,
+    .pPushConstantRanges = &pushLayout,
+  };
+  if(vkCreatePipelineLayout(wind->device, &pipelineLayoutInfo, NULL, &ret.layout) != VK_SUCCESS) {
+    ret.layout = VK_NULL_HANDLE;
+    goto end;
+  }
+
+  comp = VG_CreateShaderModule(wind, code, size);
+  if(comp == VK_NULL_HANDLE) {
+    fprintf(stderr, "failed to create shader modules\n");
+    goto end;
+  }
+
+  VkComputePipelineCreateInfo pipelineCreateInfo = {
+    .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+    .stage = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+      .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+      .module = comp,
+      .pName = "main",
+    },
+    .layout = ret.layout,
+  };
+  if(vkCreateComputePipelines(wind->device, cache, 1, &pipelineCreateInfo, NULL, &ret.pipeline) != VK_SUCCESS) {
+    fprintf(stderr, "failed to create pipeline!\n");
+    ret.pipeline = VK_NULL_HANDLE;
+  }
+
+end:
+  vkDestroyShaderModule(wind->device, comp, NULL);
+  if(ret.pipeline == VK_NULL_HANDLE && ret.layout != VK_NULL_HANDLE) {
+    vkDestroyPipelineLayout(wind->device, ret.layout, NULL);
+    ret.layout = VK_NULL_HANDLE;
+  }
+  return ret;
+}
 
 enum { OS_VERTEX, OS_COLOR, OS_NUM_ARRAYS };
 
@@ -221,38 +339,233 @@ typedef struct OldskoolArray {
   int offset;
 } OldskoolArray;
 
-enum { OS_DRAW_ARRAYS, OS_DRAW_ELEMENTS, OS_PUSHMAT, OS_CLEARCOLOR };
+enum { OS_DRAW_ARRAYS, OS_DRAW_ELEMENTS, OS_DRAW_LINE_STRIP, OS_DRAW_STRIPS, OS_DRAW_TEXTURE, OS_DRAW_DENSITY, OS_PUSHMAT, OS_CLEARCOLOR, OS_CALL_LIST };
 
 typedef struct OldskoolCmd {
   int type;
   union {
     struct {
       int prim;
+      int format;
       int start;
       int count;
+      int block;
+      int iblock;
+      int base;
+      bool wide;
+      vec4 color;
+      float point_size;
     } draw;
+    struct {
+      OldskoolBuffer * points;
+      int first;
+      int count;
+      // the segments drawn
+      int part;
+      int parts;
+      float width;
+      vec4 color;
+    } strip;
+    struct {
+      OldskoolBuffer * points;
+      OldskoolBuffer * series;
+      OldskoolBuffer * draws;
+      int slot;
+      int count;
+      float width;
+    } strips;
+    struct {
+      OldskoolTexture * tex;
+      vec4 rect;
+      vec4 uv;
+      // -1 for color textures
+      int colormap;
+      bool log_scale;
+      float range[2];
+    } texture;
+    struct {
+      OldskoolBuffer * bins;
+      int bins_x;
+      int bins_y;
+      int colormap;
+      bool log_scale;
+    } density;
+    struct {
+      OldskoolList * list;
+      mat4 matrix;
+    } call;
     mat4 matrix;
     vec4 clearcolor;
   };
 } OldskoolCmd;
 
+// immediate mode geometry is written straight into persistently mapped
+// blocks. each frame slot has its own chain of blocks, recycled once that
+// slot's fence has passed, and the chain grows by adding bigger blocks
+typedef struct OldskoolBlock {
+  VGBuffer buf;
+  void * map;
+} OldskoolBlock;
+
+typedef struct OldskoolStream {
+  int numblocks;
+  size_t blocksize;
+  OldskoolBlock * blocks;
+} OldskoolStream;
+
+// a recorded display list. its geometry lives in blocks of its own that are
+// never written again, so the draws can be replayed frame after frame
+struct OldskoolList {
+  OldskoolStream vstream;
+  OldskoolStream istream;
+  int numcmds;
+  size_t cmdsize;
+  OldskoolCmd * cmds;
+};
+
+// the write position of the immediate mode streams, and the commands and
+// matrices recorded so far. a display list records with a cursor of its own
+typedef struct OldskoolCursor {
+  int format;
+  int vblock;
+  int numverts;
+  int vertcap;
+  char * verts;
+  int iblock;
+  int numinds;
+  int indcap;
+  uint16_t * inds;
+
+  int numcmds;
+  size_t cmdsize;
+  OldskoolCmd * cmds;
+
+  mat4 lastmat;
+  int nummats;
+  size_t matsize;
+  mat4 * matstack;
+} OldskoolCursor;
+
+// what osSubmit has bound so far, to skip redundant binds and pushes
+typedef struct OldskoolBinds {
+  VkPipelineLayout layout;
+  VkPipeline pipeline;
+  VkDescriptorSet set;
+  VkBuffer vbuf;
+  VkBuffer ibuf;
+  VkIndexType indextype;
+  vec4 color;
+  float point_size;
+} OldskoolBinds;
+
+// the gpu side of a buffer object or texture. replaced wholesale when the
+// buffer grows or is respecified, the old one is retired until the gpu is
+// done with it. textures have an image instead of a buffer
+typedef struct OldskoolStorage {
+  VGBuffer buf;
+  void * map;
+  VkDescriptorPool pool;
+  VkDescriptorSet set;
+  VGImage image;
+} OldskoolStorage;
+
+typedef struct OldskoolRange {
+  size_t lo;
+  size_t hi;
+} OldskoolRange;
+
+enum { OS_MAX_DIRTY = 8 };
+
+struct OldskoolBuffer {
+  int usage;
+  size_t size;
+  OldskoolStorage storage;
+
+  // static buffers are device local. writes land in a cpu copy and the
+  // ranges the gpu hasn't seen yet are copied over by osUploadBuffers
+  void * shadow;
+  size_t shadowsize;
+  size_t uploaded;
+  bool queued;
+  int numdirty;
+  OldskoolRange dirty[OS_MAX_DIRTY];
+  // a copy is on its way over on the transfer queue, the buffer stays
+  // queued until it lands. the copy is only good up to unchanged, where
+  // the first write made since it started went
+  bool pending;
+  size_t unchanged;
+};
+
+// a big static buffer's whole contents copied into new storage on the
+// transfer queue, so frames keep drawing from the old storage meanwhile.
+// buf is null if the buffer was destroyed before it landed
+typedef struct OldskoolUpload {
+  OldskoolBuffer * buf;
+  OldskoolStorage storage;
+  VGBuffer staging;
+  VkCommandBuffer cmdbuf;
+  uint64_t value;
+  size_t size;
+} OldskoolUpload;
+
+// buffers with at least this much to upload go on the transfer queue
+enum { OS_ASYNC_UPLOAD = 4 << 20 };
+
+// an image sampled with a whole mip chain. osTexImage copies the pixels
+// into staging right away, osUploadBuffers copies them into level 0 and
+// blits the rest of the levels down from it. scalar textures have all their
+// levels made in staging, so nan texels don't spread into the smaller ones
+struct OldskoolTexture {
+  int w, h;
+  int format;
+  int levels;
+  bool nearest;
+  OldskoolStorage storage;
+  VGBuffer staging;
+  bool queued;
+  // the image has been filled at least once
+  bool ready;
+};
+
+static const VkFormat osTexFormat[OS_NUM_TEX_FORMATS] = {
+  [OS_RGBA8] = VK_FORMAT_R8G8B8A8_UNORM,
+  [OS_R32F] = VK_FORMAT_R32_SFLOAT,
+  [OS_R16F] = VK_FORMAT_R16_SFLOAT,
+};
+
+static const size_t osTexelSize[OS_NUM_TEX_FORMATS] = {
+  [OS_RGBA8] = 4,
+  [OS_R32F] = 4,
+  [OS_R16F] = 2,
+};
+
 typedef struct OldskoolContext {
   int state;
   int start;
   vec4 active_color;
+  uint32_t active_rgba8;
+
+  // the frame slot being recorded, whose streams are written to
+  int slot;
 
+  // numverts and vertcap count vertices of the current format
+  int format;
+  int vblock;
   int numverts;
-  size_t vertsize;
-  OldskoolVert * verts;
+  int vertcap;
+  char * verts;
 
+  // numinds and indcap count 16 bit slots, 32 bit indices take two
+  int iblock;
   int numinds;
-  size_t indsize;
-  unsigned * inds;
+  int indcap;
+  uint16_t * inds;
 
   bool arrays_changed;
   OldskoolArray arrays[2];
   int uploaded_array_start;
   int uploaded_array_count;
+  int uploaded_array_block;
 
   int numcmds;
   size_t cmdsize;
@@ -265,15 +578,84 @@ typedef struct OldskoolContext {
   mat4 * matstack;
 
   VGWindow * wind;
-  VGBuffer vertbuf[2];
-  void * vertmap[2];
+  OldskoolStream vstream[VG_MAX_FRAMES];
+  OldskoolStream istream[VG_MAX_FRAMES];
+
+  // the list between osNewList and osEndList, the frame's cursor is put
+  // aside meanwhile
+  OldskoolList * recording;
+  OldskoolCursor saved;
+
+  // storage retired since the last submit, and storage retired by the last
+  // submit of each slot, which is freed once that slot comes around again
+  int numdead;
+  size_t deadsize;
+  OldskoolStorage * dead;
+
+  int numretired[VG_MAX_FRAMES];
+  size_t retiredsize[VG_MAX_FRAMES];
+  OldskoolStorage * retired[VG_MAX_FRAMES];
+
+  int numdirtybufs;
+  size_t dirtybufsize;
+  OldskoolBuffer ** dirtybufs;
+
+  int numuploads;
+  size_t uploadsize;
+  OldskoolUpload * uploads;
+
+  int numdirtytexs;
+  size_t dirtytexsize;
+  OldskoolTexture ** dirtytexs;
+
+  float line_width;
+  float point_size;
+
+  VkDescriptorSetLayout set_layout;
+  // a single sampled image, for textures
+  VkDescriptorSetLayout tex_layout;
+  // linear and nearest magnification, both with linear mipmaps
+  VkSampler samplers[2];
+  int numpools;
+  VkDescriptorPool * pools;
+
+  // indexed by vertex format and primitive type
+  VkPipelineCache pipeline_cache;
+  VGPipeline pipes[OS_NUM_FORMATS][OS_NUM_PRIMS];
+  VGPipeline line_pipe;
+  VGPipeline strips_pipe;
+  VGPipeline tex_pipe;
+  VGPipeline scalar_pipe;
+  VGPipeline density_pipe;
+  VGPipeline bin_pipe;
+  VGPipeline dense_pipe;
+  VGPipeline cull_pipe;
+
+  // 0 1 2 0 2 3 for every quad of a batch, shared by all OS_QUADS draws
+  OldskoolBuffer * quad_indices;
 
-  VGBuffer indbuf[2];
-  void * indmap[2];
+} OldskoolContext;
 
-  VGPipeline triangle_pipe;
+static void * exalloc(void * ptr, size_t size, size_t *oldsize) {
+  if(size == 0) {
+    return ptr;
+  }
+  if(size <= *oldsize)
+    return ptr;
 
-} OldskoolContext;
+  size--;
+  size |= size >> 1;
+  size |= size >> 2;
+  size |= size >> 4;
+  size |= size >> 8;
+  size |= size >> 16;
+  size |= size >> 32;
+  size++;
+
+  *oldsize = size;
+
+  return realloc(ptr, size);
+}
 
 static size_t rounduppow2(size_t x) {
   x--;
@@ -287,30 +669,121 @@ static size_t rounduppow2(size_t x) {
   return x;
 }
 
-static int osAllocGpu(OldskoolContext * k, bool parity) {
-  size_t vertsize = rounduppow2(sizeof(OldskoolVert[k->numverts]));
-
-  if(vertsize > k->vertbuf[parity].size) {
-    VG_DestroyBuffer(k->wind, k->vertbuf[parity]);
-    k->vertbuf[parity] = VG_CreateBufferImpl(k->wind, sizeof(OldskoolVert[k->numverts]), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    if(k->vertbuf[parity].buf == VK_NULL_HANDLE)
-      return 1;
-    vkMapMemory(k->wind->device, k->vertbuf[parity].mem, 0, k->vertbuf[parity].size, 0, &k->vertmap[parity]);
+enum { OS_MIN_BLOCK = 1 << 16 };
+
+// makes sure the stream has a block at index holding at least minsize bytes.
+// only ever called on blocks that haven't been written this frame
+static OldskoolBlock * osGetBlock(OldskoolContext * k, OldskoolStream * stream, int index, size_t minsize, VkBufferUsageFlags usage) {
+  if(index < stream->numblocks && stream->blocks[index].buf.size >= minsize)
+    return &stream->blocks[index];
+
+  size_t size = index ? 2 * stream->blocks[index-1].buf.size : OS_MIN_BLOCK;
+  if(size < minsize)
+    size = rounduppow2(minsize);
+
+  OldskoolBlock block;
+  block.buf = VG_CreateBufferImpl(k->wind, size, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if(block.buf.buf == VK_NULL_HANDLE)
+    return NULL;
+  block.map = block.buf.map;
+
+  if(index < stream->numblocks) {
+    // too small, but its slot's fence has passed so it can go right away
+    VG_DestroyBuffer(k->wind, stream->blocks[index].buf);
+  } else {
+    assert(index == stream->numblocks);
+    stream->numblocks++;
+    stream->blocks = exalloc(stream->blocks, sizeof(OldskoolBlock[stream->numblocks]), &stream->blocksize);
   }
+  stream->blocks[index] = block;
+  return &stream->blocks[index];
+}
 
-  size_t indsize = rounduppow2(sizeof(unsigned[k->numinds]));
+static void osFreeStream(OldskoolContext * k, OldskoolStream * stream) {
+  for(int i = 0; i < stream->numblocks; i++)
+    VG_DestroyBuffer(k->wind, stream->blocks[i].buf);
+  free(stream->blocks);
+  *stream = (OldskoolStream) { 0, 0, NULL };
+}
 
-  if(indsize > k->indbuf[parity].size) {
-    VG_DestroyBuffer(k->wind, k->indbuf[parity]);
-    k->indbuf[parity] = VG_CreateBufferImpl(k->wind, sizeof(unsigned[k->numinds]), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    if(k->indbuf[parity].buf == VK_NULL_HANDLE)
-      return 1;
-    vkMapMemory(k->wind->device, k->indbuf[parity].mem, 0, k->indbuf[parity].size, 0, &k->indmap[parity]);
-  }
+// the streams immediate mode data goes to, the frame slot's or the list's
+static OldskoolStream * osVStream(OldskoolContext * k) {
+  return k->recording ? &k->recording->vstream : &k->vstream[k->slot];
+}
+
+static OldskoolStream * osIStream(OldskoolContext * k) {
+  return k->recording ? &k->recording->istream : &k->istream[k->slot];
+}
+
+static const size_t osFormatStride[OS_NUM_FORMATS] = {
+  [OS_C4F_V4F] = sizeof(OldskoolVert),
+  [OS_C4UB_V2F] = sizeof(OldskoolVertC4UB),
+  [OS_V2F] = sizeof(OldskoolVert2),
+};
+
+// switches the stream to another vertex format. draws index vertices from the
+// start of the block, so the write position is rounded up to a whole vertex
+static void osStreamFormat(OldskoolContext * k, int format) {
+  size_t used = k->numverts * osFormatStride[k->format];
+  size_t stride = osFormatStride[format];
+  k->format = format;
+  k->numverts = (used + stride - 1) / stride;
+  k->vertcap = k->verts ? osVStream(k)->blocks[k->vblock].buf.size / stride : 0;
+}
+
+// makes room for count contiguous vertices, moving on to the next block if
+// the current one is full. callers in the middle of a primitive have to
+// carry over its vertices themselves
+static int osVertSpace(OldskoolContext * k, int count) {
+  if(k->numverts + count <= k->vertcap)
+    return 0;
+  size_t stride = osFormatStride[k->format];
+  int index = k->numverts ? k->vblock + 1 : k->vblock;
+  OldskoolBlock * block = osGetBlock(k, osVStream(k), index, count * stride, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+  if(!block)
+    return 1;
+  k->vblock = index;
+  k->numverts = 0;
+  k->vertcap = block->buf.size / stride;
+  k->verts = block->map;
+  return 0;
+}
 
+static int osIndSpace(OldskoolContext * k, int count) {
+  if(k->numinds + count <= k->indcap)
+    return 0;
+  int index = k->numinds ? k->iblock + 1 : k->iblock;
+  OldskoolBlock * block = osGetBlock(k, osIStream(k), index, sizeof(uint16_t[count]), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+  if(!block)
+    return 1;
+  k->iblock = index;
+  k->numinds = 0;
+  k->indcap = block->buf.size / sizeof(uint16_t);
+  k->inds = block->map;
   return 0;
 }
 
+static const VkPrimitiveTopology osTopology[OS_NUM_PRIMS] = {
+  [OS_POINTS] = VK_PRIMITIVE_TOPOLOGY_POINT_LIST,
+  [OS_LINES] = VK_PRIMITIVE_TOPOLOGY_LINE_LIST,
+  [OS_TRIANGLES] = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+  [OS_LINE_STRIP] = VK_PRIMITIVE_TOPOLOGY_LINE_STRIP,
+  [OS_TRIANGLE_STRIP] = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+  [OS_QUADS] = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+};
+
+// quads per draw call, the most that 16 bit indices can reach
+enum { OS_QUAD_BATCH = 1 << 14 };
+
+static void osCreateFormatPipes(OldskoolContext * k, int format, char * code, size_t size, const VkPipelineVertexInputStateCreateInfo * vertexInput) {
+  for(int prim = OS_POINTS; prim < OS_NUM_PRIMS; prim++) {
+    // quads use the triangle pipeline
+    if(prim == OS_QUADS)
+      continue;
+    k->pipes[format][prim] = VG_CreatePipeline(k->wind, k->pipeline_cache, k->set_layout, 1, code, size, _binary_frag_spv_start, _binary_frag_spv_end - _binary_frag_spv_start, vertexInput, osTopology[prim], false);
+  }
+}
+
 OldskoolContext * osCreate(VGWindow * wind) {
   OldskoolContext * ret = malloc(sizeof(OldskoolContext));
   *ret = (OldskoolContext) {
@@ -318,12 +791,17 @@ OldskoolContext * osCreate(VGWindow * wind) {
     .start = 0,
     .active_color = make_vec4(0, 0, 0, 1),
 
+    .slot = 0,
+
+    .format = OS_C4F_V4F,
+    .vblock = 0,
     .numverts = 0,
-    .vertsize = 0,
+    .vertcap = 0,
     .verts = NULL,
 
+    .iblock = 0,
     .numinds = 0,
-    .indsize = 0,
+    .indcap = 0,
     .inds = NULL,
     
     .numcmds = 0,
@@ -338,79 +816,1284 @@ OldskoolContext * osCreate(VGWindow * wind) {
 
     .wind = wind,
 
-    .vertbuf = { [0 ... 1] = { VK_NULL_HANDLE, VK_NULL_HANDLE, 0 } },
-    .indbuf = { [0 ... 1] = { VK_NULL_HANDLE, VK_NULL_HANDLE, 0 } },
+    .vstream = { [0 ... VG_MAX_FRAMES - 1] = { 0, 0, NULL } },
+    .istream = { [0 ... VG_MAX_FRAMES - 1] = { 0, 0, NULL } },
+
+    .recording = NULL,
+
+    .numdead = 0,
+    .deadsize = 0,
+    .dead = NULL,
+
+    .numretired = { 0 },
+    .retiredsize = { 0 },
+    .retired = { NULL },
+
+    .numdirtybufs = 0,
+    .dirtybufsize = 0,
+    .dirtybufs = NULL,
+
+    .numuploads = 0,
+    .uploadsize = 0,
+    .uploads = NULL,
+
+    .numdirtytexs = 0,
+    .dirtytexsize = 0,
+    .dirtytexs = NULL,
+
+    .line_width = 1,
+    .point_size = 1,
+
+    .numpools = 0,
+    .pools = NULL,
   };
   *ret->matstack = mat4_id();
+  osColor4(ret, make_vec4(0, 0, 0, 1));
 
   memset(&ret->lastmat, -1, sizeof ret->lastmat);
 
-  ret->triangle_pipe = VG_CreatePipeline(wind);
+  {
+    VkPipelineCacheCreateInfo createInfo = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+    };
+    if(vkCreatePipelineCache(wind->device, &createInfo, NULL, &ret->pipeline_cache) != VK_SUCCESS)
+      ret->pipeline_cache = VK_NULL_HANDLE;
+  }
+
+  {
+    VkDescriptorSetLayoutBinding binding = {
+      .binding = 0,
+      .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+      .descriptorCount = 1,
+      .stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT,
+    };
+    VkDescriptorSetLayoutCreateInfo createInfo = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+      .bindingCount = 1,
+      .pBindings = &binding,
+    };
+    if(vkCreateDescriptorSetLayout(wind->device, &createInfo, NULL, &ret->set_layout) != VK_SUCCESS) {
+      fprintf(stderr, "failed to create descriptor set layout\n");
+      ret->set_layout = VK_NULL_HANDLE;
+    }
+
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    if(vkCreateDescriptorSetLayout(wind->device, &createInfo, NULL, &ret->tex_layout) != VK_SUCCESS) {
+      fprintf(stderr, "failed to create descriptor set layout\n");
+      ret->tex_layout = VK_NULL_HANDLE;
+    }
+  }
+
+  for(int nearest = 0; nearest < 2; nearest++) {
+    VkSamplerCreateInfo createInfo = {
+      .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+      .magFilter = nearest ? VK_FILTER_NEAREST : VK_FILTER_LINEAR,
+      .minFilter = VK_FILTER_LINEAR,
+      .mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+      .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+      .minLod = 0,
+      .maxLod = VK_LOD_CLAMP_NONE,
+    };
+    if(vkCreateSampler(wind->device, &createInfo, NULL, &ret->samplers[nearest]) != VK_SUCCESS) {
+      fprintf(stderr, "failed to create sampler\n");
+      ret->samplers[nearest] = VK_NULL_HANDLE;
+    }
+  }
+
+  {
+    VkVertexInputBindingDescription vertexBinding = {
+      .binding = 0,
+      .stride = sizeof(OldskoolVert),
+      .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+    };
+
+    VkVertexInputAttributeDescription vertexAttribs[] = {
+      {
+        .binding = 0,
+        .location = 0,
+        .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+        .offset = offsetof(OldskoolVert, pos),
+      },
+      {
+        .binding = 0,
+        .location = 1,
+        .format = VK_FORMAT_R32G32B32A32_SFLOAT,
+        .offset = offsetof(OldskoolVert, color),
+      },
+    };
+
+    VkPipelineVertexInputStateCreateInfo vertexInput = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+      .vertexBindingDescriptionCount = 1,
+      .pVertexBindingDescriptions = &vertexBinding,
+      .vertexAttributeDescriptionCount = sizeof vertexAttribs / sizeof *vertexAttribs,
+      .pVertexAttributeDescriptions = vertexAttribs,
+    };
+    osCreateFormatPipes(ret, OS_C4F_V4F, _binary_vert_spv_start, _binary_vert_spv_end - _binary_vert_spv_start, &vertexInput);
+  }
+
+  {
+    // same shader, the missing z and w of the position read as 0 and 1
+    VkVertexInputBindingDescription vertexBinding = {
+      .binding = 0,
+      .stride = sizeof(OldskoolVertC4UB),
+      .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+    };
+
+    VkVertexInputAttributeDescription vertexAttribs[] = {
+      {
+        .binding = 0,
+        .location = 0,
+        .format = VK_FORMAT_R32G32_SFLOAT,
+        .offset = offsetof(OldskoolVertC4UB, x),
+      },
+      {
+        .binding = 0,
+        .location = 1,
+        .format = VK_FORMAT_R8G8B8A8_UNORM,
+        .offset = offsetof(OldskoolVertC4UB, color),
+      },
+    };
+
+    VkPipelineVertexInputStateCreateInfo vertexInput = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+      .vertexBindingDescriptionCount = 1,
+      .pVertexBindingDescriptions = &vertexBinding,
+      .vertexAttributeDescriptionCount = sizeof vertexAttribs / sizeof *vertexAttribs,
+      .pVertexAttributeDescriptions = vertexAttribs,
+    };
+    osCreateFormatPipes(ret, OS_C4UB_V2F, _binary_vert_spv_start, _binary_vert_spv_end - _binary_vert_spv_start, &vertexInput);
+  }
+
+  {
+    // color comes from the push constants
+    VkVertexInputBindingDescription vertexBinding = {
+      .binding = 0,
+      .stride = sizeof(OldskoolVert2),
+      .inputRate = VK_VERTEX_INPUT_RATE_VERTEX,
+    };
+
+    VkVertexInputAttributeDescription vertexAttrib = {
+      .binding = 0,
+      .location = 0,
+      .format = VK_FORMAT_R32G32_SFLOAT,
+      .offset = offsetof(OldskoolVert2, x),
+    };
+
+    VkPipelineVertexInputStateCreateInfo vertexInput = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+      .vertexBindingDescriptionCount = 1,
+      .pVertexBindingDescriptions = &vertexBinding,
+      .vertexAttributeDescriptionCount = 1,
+      .pVertexAttributeDescriptions = &vertexAttrib,
+    };
+    osCreateFormatPipes(ret, OS_V2F, _binary_flat_vert_spv_start, _binary_flat_vert_spv_end - _binary_flat_vert_spv_start, &vertexInput);
+  }
+
+  {
+    // vertices are pulled out of a storage buffer, nothing to bind
+    VkPipelineVertexInputStateCreateInfo vertexInput = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+    };
+    // without msaa the lines antialias themselves
+    if(wind->msaa_samples > 1) {
+      ret->line_pipe = VG_CreatePipeline(wind, ret->pipeline_cache, ret->set_layout, 1, _binary_line_vert_spv_start, _binary_line_vert_spv_end - _binary_line_vert_spv_start, _binary_frag_spv_start, _binary_frag_spv_end - _binary_frag_spv_start, &vertexInput, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, false);
+      ret->strips_pipe = VG_CreatePipeline(wind, ret->pipeline_cache, ret->set_layout, 2, _binary_strips_vert_spv_start, _binary_strips_vert_spv_end - _binary_strips_vert_spv_start, _binary_frag_spv_start, _binary_frag_spv_end - _binary_frag_spv_start, &vertexInput, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, false);
+    } else {
+      ret->line_pipe = VG_CreatePipeline(wind, ret->pipeline_cache, ret->set_layout, 1, _binary_line_vert_spv_start, _binary_line_vert_spv_end - _binary_line_vert_spv_start, _binary_line_frag_spv_start, _binary_line_frag_spv_end - _binary_line_frag_spv_start, &vertexInput, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, true);
+      ret->strips_pipe = VG_CreatePipeline(wind, ret->pipeline_cache, ret->set_layout, 2, _binary_strips_vert_spv_start, _binary_strips_vert_spv_end - _binary_strips_vert_spv_start, _binary_line_frag_spv_start, _binary_line_frag_spv_end - _binary_line_frag_spv_start, &vertexInput, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, true);
+    }
+    // two triangles with the corners in the push constants, blended for
+    // the alpha of the image
+    ret->tex_pipe = VG_CreatePipeline(wind, ret->pipeline_cache, ret->tex_layout, 1, _binary_tex_vert_spv_start, _binary_tex_vert_spv_end - _binary_tex_vert_spv_start, _binary_tex_frag_spv_start, _binary_tex_frag_spv_end - _binary_tex_frag_spv_start, &vertexInput, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, true);
+    ret->scalar_pipe = VG_CreatePipeline(wind, ret->pipeline_cache, ret->tex_layout, 1, _binary_tex_vert_spv_start, _binary_tex_vert_spv_end - _binary_tex_vert_spv_start, _binary_scalar_frag_spv_start, _binary_scalar_frag_spv_end - _binary_scalar_frag_spv_start, &vertexInput, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, false);
+    // a screen covering triangle reading its color out of the bins
+    ret->density_pipe = VG_CreatePipeline(wind, ret->pipeline_cache, ret->set_layout, 1, _binary_density_vert_spv_start, _binary_density_vert_spv_end - _binary_density_vert_spv_start, _binary_density_frag_spv_start, _binary_density_frag_spv_end - _binary_density_frag_spv_start, &vertexInput, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, false);
+  }
+
+  ret->bin_pipe = VG_CreateComputePipeline(wind, ret->pipeline_cache, ret->set_layout, 2, _binary_bin_comp_spv_start, _binary_bin_comp_spv_end - _binary_bin_comp_spv_start);
+  ret->dense_pipe = VG_CreateComputePipeline(wind, ret->pipeline_cache, ret->set_layout, 3, _binary_dense_comp_spv_start, _binary_dense_comp_spv_end - _binary_dense_comp_spv_start);
+  ret->cull_pipe = VG_CreateComputePipeline(wind, ret->pipeline_cache, ret->set_layout, 2, _binary_cull_comp_spv_start, _binary_cull_comp_spv_end - _binary_cull_comp_spv_start);
+
+  {
+    // uploaded with the first osUploadBuffers
+    uint16_t * indices = malloc(sizeof(uint16_t[6 * OS_QUAD_BATCH]));
+    for(int i = 0; i < OS_QUAD_BATCH; i++) {
+      uint16_t * quad = indices + 6 * i;
+      uint16_t v = 4 * i;
+      quad[0] = v + 0; quad[1] = v + 1; quad[2] = v + 2;
+      quad[3] = v + 0; quad[4] = v + 2; quad[5] = v + 3;
+    }
+    ret->quad_indices = osCreateBuffer(ret, OS_STATIC_DRAW);
+    osBufferData(ret, ret->quad_indices, sizeof(uint16_t[6 * OS_QUAD_BATCH]), indices);
+    free(indices);
+  }
 
   return ret;
 }
+
+static void osFreeStorage(OldskoolContext * k, OldskoolStorage * storage) {
+  if(storage->set != VK_NULL_HANDLE)
+    vkFreeDescriptorSets(k->wind->device, storage->pool, 1, &storage->set);
+  VG_DestroyBuffer(k->wind, storage->buf);
+  VG_DestroyImage(k->wind, storage->image);
+  *storage = (OldskoolStorage) { { VK_NULL_HANDLE, VK_NULL_HANDLE, 0 } };
+}
+
+static void osFreeRetired(OldskoolContext * k, int slot) {
+  for(int i = 0; i < k->numretired[slot]; i++)
+    osFreeStorage(k, &k->retired[slot][i]);
+  k->numretired[slot] = 0;
+}
+
+static void osFreeUpload(OldskoolContext * k, OldskoolUpload * up) {
+  osFreeStorage(k, &up->storage);
+  VG_DestroyBuffer(k->wind, up->staging);
+  vkFreeCommandBuffers(k->wind->device, k->wind->transfer_pool, 1, &up->cmdbuf);
+}
+
 void osDestroy(OldskoolContext * k) {
   VG_WaitIdle(k->wind);
-  VG_DestroyBuffer(k->wind, k->vertbuf[0]);
-  VG_DestroyBuffer(k->wind, k->vertbuf[1]);
-  VG_DestroyBuffer(k->wind, k->indbuf[0]);
-  VG_DestroyBuffer(k->wind, k->indbuf[1]);
-  VG_DestroyPipeline(k->wind, k->triangle_pipe);
+  osDestroyBuffer(k, k->quad_indices);
+  for(int i = 0; i < VG_MAX_FRAMES; i++) {
+    osFreeStream(k, &k->vstream[i]);
+    osFreeStream(k, &k->istream[i]);
+    osFreeRetired(k, i);
+  }
+  for(int i = 0; i < k->numdead; i++)
+    osFreeStorage(k, &k->dead[i]);
+  for(int i = 0; i < k->numuploads; i++)
+    osFreeUpload(k, &k->uploads[i]);
+
+  for(int i = 0; i < OS_NUM_FORMATS; i++)
+    for(int j = OS_POINTS; j < OS_NUM_PRIMS; j++)
+      VG_DestroyPipeline(k->wind, k->pipes[i][j]);
+  VG_DestroyPipeline(k->wind, k->line_pipe);
+  VG_DestroyPipeline(k->wind, k->strips_pipe);
+  VG_DestroyPipeline(k->wind, k->tex_pipe);
+  VG_DestroyPipeline(k->wind, k->scalar_pipe);
+  VG_DestroyPipeline(k->wind, k->density_pipe);
+  VG_DestroyPipeline(k->wind, k->bin_pipe);
+  VG_DestroyPipeline(k->wind, k->dense_pipe);
+  VG_DestroyPipeline(k->wind, k->cull_pipe);
+  vkDestroyPipelineCache(k->wind->device, k->pipeline_cache, NULL);
+  for(int i = 0; i < k->numpools; i++)
+    vkDestroyDescriptorPool(k->wind->device, k->pools[i], NULL);
+  vkDestroyDescriptorSetLayout(k->wind->device, k->set_layout, NULL);
+  vkDestroyDescriptorSetLayout(k->wind->device, k->tex_layout, NULL);
+  for(int i = 0; i < 2; i++)
+    vkDestroySampler(k->wind->device, k->samplers[i], NULL);
 
-  free(k->verts);
   free(k->cmds);
+  free(k->matstack);
+  free(k->dead);
+  for(int i = 0; i < VG_MAX_FRAMES; i++)
+    free(k->retired[i]);
+  free(k->dirtybufs);
+  free(k->uploads);
+  free(k->dirtytexs);
+  free(k->pools);
 
   free(k);
 }
 
-void osSubmit(OldskoolContext * k, VkCommandBuffer cmdbuf, bool parity) {
-  assert(!osAllocGpu(k, parity));
-  memcpy(k->vertmap[parity], k->verts, sizeof(OldskoolVert[k->numverts]));
-  memcpy(k->indmap[parity], k->inds, sizeof(unsigned[k->numinds]));
+static void osRetireStorage(OldskoolContext * k, OldskoolStorage * storage) {
+  if(storage->buf.buf == VK_NULL_HANDLE)
+    return;
+  k->numdead++;
+  k->dead = exalloc(k->dead, sizeof(OldskoolStorage[k->numdead]), &k->deadsize);
+  k->dead[k->numdead-1] = *storage;
+  *storage = (OldskoolStorage) { { VK_NULL_HANDLE, VK_NULL_HANDLE, 0 } };
+}
 
-  VGPipeline pipe = k->triangle_pipe;
-  mat4 id = mat4_id();
-  vkCmdPushConstants(cmdbuf, pipe.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(mat4), &id);
+static VkDescriptorSet osAllocSet(OldskoolContext * k, VkDescriptorSetLayout layout, VkDescriptorPool * pool) {
+  VkDescriptorSet set = VK_NULL_HANDLE;
+  VkDescriptorSetAllocateInfo allocInfo = {
+    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+    .descriptorSetCount = 1,
+    .pSetLayouts = &layout,
+  };
+  if(k->numpools) {
+    allocInfo.descriptorPool = k->pools[k->numpools-1];
+    if(vkAllocateDescriptorSets(k->wind->device, &allocInfo, &set) == VK_SUCCESS) {
+      *pool = allocInfo.descriptorPool;
+      return set;
+    }
+  }
 
-  vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipe.pipeline);
+  // last pool is full, chain on a new one
+  VkDescriptorPoolSize poolSizes[] = {
+    {
+      .type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+      .descriptorCount = 64,
+    },
+    {
+      .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+      .descriptorCount = 64,
+    },
+  };
+  VkDescriptorPoolCreateInfo createInfo = {
+    .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+    .flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
+    .maxSets = 64,
+    .poolSizeCount = sizeof poolSizes / sizeof *poolSizes,
+    .pPoolSizes = poolSizes,
+  };
+  VkDescriptorPool newpool;
+  if(vkCreateDescriptorPool(k->wind->device, &createInfo, NULL, &newpool) != VK_SUCCESS)
+    return VK_NULL_HANDLE;
+  k->numpools++;
+  k->pools = realloc(k->pools, sizeof(VkDescriptorPool[k->numpools]));
+  k->pools[k->numpools-1] = newpool;
 
-  VkViewport viewport = {
-    .x = 0,
-    .y = 0,
-    .width = k->wind->swap_extent.width,
-    .height = k->wind->swap_extent.height,
-    .minDepth = 0,
-    .maxDepth = 1,
+  allocInfo.descriptorPool = newpool;
+  if(vkAllocateDescriptorSets(k->wind->device, &allocInfo, &set) != VK_SUCCESS)
+    return VK_NULL_HANDLE;
+  *pool = newpool;
+  return set;
+}
+
+static int osAllocStorage(OldskoolContext * k, OldskoolStorage * storage, size_t size, int usage) {
+  *storage = (OldskoolStorage) { { VK_NULL_HANDLE, VK_NULL_HANDLE, 0 } };
+  VkBufferUsageFlags bufusage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+  if(usage == OS_STATIC_DRAW) {
+    bufusage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    storage->buf = VG_CreateBufferImpl(k->wind, size, bufusage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  } else {
+    storage->buf = VG_CreateBufferImpl(k->wind, size, bufusage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  }
+  if(storage->buf.buf == VK_NULL_HANDLE)
+    return 1;
+  if(usage != OS_STATIC_DRAW)
+    storage->map = storage->buf.map;
+
+  storage->set = osAllocSet(k, k->set_layout, &storage->pool);
+  if(storage->set == VK_NULL_HANDLE) {
+    osFreeStorage(k, storage);
+    return 1;
+  }
+  VkDescriptorBufferInfo bufferInfo = {
+    .buffer = storage->buf.buf,
+    .offset = 0,
+    .range = VK_WHOLE_SIZE,
   };
-  VkRect2D scissor = {
-    .offset = { 0, 0 },
-    .extent = k->wind->swap_extent,
+  VkWriteDescriptorSet write = {
+    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+    .dstSet = storage->set,
+    .dstBinding = 0,
+    .descriptorCount = 1,
+    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+    .pBufferInfo = &bufferInfo,
   };
-  vkCmdSetViewport(cmdbuf, 0, 1, &viewport);
-  vkCmdSetScissor(cmdbuf, 0, 1, &scissor);
+  vkUpdateDescriptorSets(k->wind->device, 1, &write, 0, NULL);
+  return 0;
+}
+
+OldskoolBuffer * osCreateBuffer(OldskoolContext * k, int usage) {
+  assert(usage == OS_STATIC_DRAW || usage == OS_STREAM_DRAW);
+  OldskoolBuffer * ret = malloc(sizeof(OldskoolBuffer));
+  *ret = (OldskoolBuffer) {
+    .usage = usage,
+    .size = 0,
+    .storage = { { VK_NULL_HANDLE, VK_NULL_HANDLE, 0 } },
+
+    .shadow = NULL,
+    .shadowsize = 0,
+    .uploaded = 0,
+    .queued = false,
+    .numdirty = 0,
+    .pending = false,
+    .unchanged = 0,
+  };
+  return ret;
+}
+
+void osDestroyBuffer(OldskoolContext * k, OldskoolBuffer * buf) {
+  if(buf->queued) {
+    for(int i = 0; i < k->numdirtybufs; i++) {
+      if(k->dirtybufs[i] == buf) {
+        k->dirtybufs[i] = k->dirtybufs[--k->numdirtybufs];
+        break;
+      }
+    }
+  }
+  if(buf->pending) {
+    for(int i = 0; i < k->numuploads; i++)
+      if(k->uploads[i].buf == buf)
+        k->uploads[i].buf = NULL;
+  }
+  osRetireStorage(k, &buf->storage);
+  free(buf->shadow);
+  free(buf);
+}
+
+static void osMarkDirty(OldskoolContext * k, OldskoolBuffer * buf, size_t lo, size_t hi) {
+  if(buf->pending && lo < buf->unchanged)
+    buf->unchanged = lo;
+  if(!buf->queued) {
+    buf->queued = true;
+    k->numdirtybufs++;
+    k->dirtybufs = exalloc(k->dirtybufs, sizeof(OldskoolBuffer*[k->numdirtybufs]), &k->dirtybufsize);
+    k->dirtybufs[k->numdirtybufs-1] = buf;
+  }
+
+  // swallow every range this one overlaps or touches, appends coalesce
+  // into a single growing range this way
+  for(int i = 0; i < buf->numdirty; i++) {
+    OldskoolRange r = buf->dirty[i];
+    if(lo <= r.hi && r.lo <= hi) {
+      lo = lo < r.lo ? lo : r.lo;
+      hi = hi > r.hi ? hi : r.hi;
+      buf->dirty[i] = buf->dirty[--buf->numdirty];
+      i = -1;
+    }
+  }
+  if(buf->numdirty == OS_MAX_DIRTY) {
+    // too fragmented to be worth tracking, upload the whole span
+    for(int i = 0; i < buf->numdirty; i++) {
+      lo = lo < buf->dirty[i].lo ? lo : buf->dirty[i].lo;
+      hi = hi > buf->dirty[i].hi ? hi : buf->dirty[i].hi;
+    }
+    buf->numdirty = 0;
+  }
+  buf->dirty[buf->numdirty++] = (OldskoolRange) { lo, hi };
+}
+
+int osBufferData(OldskoolContext * k, OldskoolBuffer * buf, size_t size, const void * data) {
+  if(buf->usage == OS_STATIC_DRAW) {
+    // the upload is ordered after frames in flight, no need to orphan
+    buf->size = size;
+    buf->uploaded = 0;
+    buf->numdirty = 0;
+    buf->unchanged = 0;
+    buf->shadow = exalloc(buf->shadow, size, &buf->shadowsize);
+    if(data)
+      memcpy(buf->shadow, data, size);
+    else
+      memset(buf->shadow, 0, size);
+    if(size)
+      osMarkDirty(k, buf, 0, size);
+    return 0;
+  }
+
+  // like glBufferData this orphans the old storage, so frames in flight
+  // keep drawing from it
+  osRetireStorage(k, &buf->storage);
+  buf->size = 0;
+  if(size == 0)
+    return 0;
+  if(osAllocStorage(k, &buf->storage, rounduppow2(size), buf->usage))
+    return 1;
+  buf->size = size;
+  if(data)
+    memcpy(buf->storage.map, data, size);
+  return 0;
+}
+
+int osBufferStorage(OldskoolContext * k, OldskoolBuffer * buf, size_t size) {
+  assert(buf->usage == OS_STATIC_DRAW && !buf->queued && !buf->pending);
+  osRetireStorage(k, &buf->storage);
+  buf->size = 0;
+  buf->uploaded = 0;
+  if(size == 0)
+    return 0;
+  if(osAllocStorage(k, &buf->storage, rounduppow2(size), buf->usage))
+    return 1;
+  buf->size = size;
+  buf->uploaded = size;
+  return 0;
+}
+
+int osBufferSubData(OldskoolContext * k, OldskoolBuffer * buf, size_t offset, size_t size, const void * data) {
+  size_t end = offset + size;
+  if(size == 0)
+    return 0;
+
+  if(buf->usage == OS_STATIC_DRAW) {
+    buf->shadow = exalloc(buf->shadow, end, &buf->shadowsize);
+    memcpy(buf->shadow + offset, data, size);
+    if(end > buf->size)
+      buf->size = end;
+    osMarkDirty(k, buf, offset, end);
+    return 0;
+  }
+
+  if(end > buf->storage.buf.size) {
+    OldskoolStorage grown;
+    if(osAllocStorage(k, &grown, rounduppow2(end), buf->usage))
+      return 1;
+    if(buf->size)
+      memcpy(grown.map, buf->storage.map, buf->size);
+    osRetireStorage(k, &buf->storage);
+    buf->storage = grown;
+  }
+  memcpy(buf->storage.map + offset, data, size);
+  if(end > buf->size)
+    buf->size = end;
+  return 0;
+}
+
+static VkFormatFeatureFlags osTexFeatures(OldskoolContext * k, int format) {
+  VkFormatProperties props;
+  vkGetPhysicalDeviceFormatProperties(k->wind->physical_device, osTexFormat[format], &props);
+  return props.optimalTilingFeatures;
+}
+
+bool osTexFormatFilters(OldskoolContext * k, int format) {
+  return osTexFeatures(k, format) & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+}
+
+OldskoolTexture * osCreateTexture(OldskoolContext * k, int w, int h, int format, bool nearest) {
+  assert(0 <= format && format < OS_NUM_TEX_FORMATS);
+  VGWindow * wind = k->wind;
+  VkFormat vkformat = osTexFormat[format];
+
+  // the mip chain is blitted down on the gpu, or made on the cpu for the
+  // scalar formats, and needs the format to filter. without it the texture
+  // makes do with one level
+  VkFormatFeatureFlags mips = VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+  if(format == OS_RGBA8)
+    mips |= VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+  int levels = 1;
+  if((osTexFeatures(k, format) & mips) == mips)
+    while((w | h) >> levels)
+      levels++;
+
+  OldskoolTexture * ret = malloc(sizeof(OldskoolTexture));
+  *ret = (OldskoolTexture) {
+    .w = w,
+    .h = h,
+    .format = format,
+    .levels = levels,
+    .nearest = nearest,
+    .storage = { { VK_NULL_HANDLE, VK_NULL_HANDLE, 0 } },
+    .staging = { VK_NULL_HANDLE, VK_NULL_HANDLE, 0 },
+    .queued = false,
+    .ready = false,
+  };
+
+  OldskoolStorage * storage = &ret->storage;
+  storage->image = VG_CreateImageImpl(wind, w, h, levels, VK_SAMPLE_COUNT_1_BIT, vkformat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  if(storage->image.view == VK_NULL_HANDLE)
+    goto fail;
+  storage->set = osAllocSet(k, k->tex_layout, &storage->pool);
+  if(storage->set == VK_NULL_HANDLE)
+    goto fail;
+
+  VkDescriptorImageInfo imageInfo = {
+    .sampler = k->samplers[nearest],
+    .imageView = storage->image.view,
+    .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+  };
+  VkWriteDescriptorSet write = {
+    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+    .dstSet = storage->set,
+    .dstBinding = 0,
+    .descriptorCount = 1,
+    .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+    .pImageInfo = &imageInfo,
+  };
+  vkUpdateDescriptorSets(wind->device, 1, &write, 0, NULL);
+  return ret;
+
+fail:
+  fprintf(stderr, "failed to create texture\n");
+  osFreeStorage(k, storage);
+  free(ret);
+  return NULL;
+}
+
+void osDestroyTexture(OldskoolContext * k, OldskoolTexture * tex) {
+  if(tex->queued) {
+    for(int i = 0; i < k->numdirtytexs; i++) {
+      if(k->dirtytexs[i] == tex) {
+        k->dirtytexs[i] = k->dirtytexs[--k->numdirtytexs];
+        break;
+      }
+    }
+  }
+  VG_DestroyBuffer(k->wind, tex->staging);
+  osRetireStorage(k, &tex->storage);
+  free(tex);
+}
+
+// rounded to nearest, ties away from zero
+static uint16_t osToHalf(float f) {
+  uint32_t x;
+  memcpy(&x, &f, sizeof x);
+  uint16_t sign = (x >> 16) & 0x8000;
+  int exp = (x >> 23) & 0xff;
+  uint32_t mant = x & 0x7fffff;
+  if(exp == 0xff)
+    return sign | 0x7c00 | (mant ? 0x200 : 0);
+  int e = exp - 127 + 15;
+  if(e >= 0x1f)
+    return sign | 0x7c00;
+  if(e <= 0) {
+    // subnormal, or too small for even that
+    if(e < -10)
+      return sign;
+    mant |= 0x800000;
+    int shift = 14 - e;
+    return sign | ((mant >> shift) + ((mant >> (shift - 1)) & 1));
+  }
+  // a carry out of the mantissa rounds up into the exponent, as it should
+  return (sign | (e << 10) | (mant >> 13)) + ((mant >> 12) & 1);
+}
+
+// a level of the mip chain is half the one above, rounded down
+static int osMipSize(int size, int level) {
+  size >>= level;
+  return size > 0 ? size : 1;
+}
+
+// the levels of a scalar texture one after another into out. each texel is
+// the average of the 2x2 above it that aren't nan, nan only when they all
+// are. they're made as floats, in place, and stored in the texture's format
+static void osScalarLevels(OldskoolTexture * tex, int row_length, const float * pixels, char * out) {
+  int w = tex->w, h = tex->h;
+  float * level = malloc(sizeof(float[h][w]));
+  for(int y = 0; y < h; y++)
+    memcpy(level + (size_t)y * w, pixels + (size_t)y * row_length, sizeof(float[w]));
+  for(int l = 0; l < tex->levels; l++) {
+    if(l > 0) {
+      // each texel's 2x2 comes after where it goes
+      int nw = osMipSize(w, 1), nh = osMipSize(h, 1);
+      for(int y = 0; y < nh; y++) {
+        const float * r0 = level + (size_t)(2 * y) * w;
+        const float * r1 = 2 * y + 1 < h ? r0 + w : r0;
+        for(int x = 0; x < nw; x++) {
+          int x1 = 2 * x + 1 < w ? 2 * x + 1 : 2 * x;
+          float v[4] = { r0[2 * x], r0[x1], r1[2 * x], r1[x1] };
+          float sum = 0;
+          int n = 0;
+          for(int c = 0; c < 4; c++) {
+            if(!isnan(v[c])) {
+              sum += v[c];
+              n++;
+            }
+          }
+          level[(size_t)y * nw + x] = n ? sum / n : NAN;
+        }
+      }
+      w = nw;
+      h = nh;
+    }
+    size_t n = (size_t)w * h;
+    if(tex->format == OS_R16F) {
+      for(size_t i = 0; i < n; i++)
+        ((uint16_t*)out)[i] = osToHalf(level[i]);
+    } else {
+      memcpy(out, level, sizeof(float[n]));
+    }
+    out += osTexelSize[tex->format] * n;
+  }
+  free(level);
+}
+
+int osTexImage(OldskoolContext * k, OldskoolTexture * tex, int row_length, const void * pixels) {
+  size_t texel = osTexelSize[tex->format];
+  size_t row = texel * tex->w;
+  bool scalar = tex->format != OS_RGBA8;
+  size_t size = 0;
+  for(int l = 0; l < (scalar ? tex->levels : 1); l++)
+    size += texel * osMipSize(tex->w, l) * osMipSize(tex->h, l);
+  VGBuffer staging = VG_CreateBufferImpl(k->wind, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if(staging.buf == VK_NULL_HANDLE)
+    return 1;
+  if(scalar)
+    osScalarLevels(tex, row_length, pixels, staging.map);
+  else
+    for(int y = 0; y < tex->h; y++)
+      memcpy((char*)staging.map + y * row, (const char*)pixels + y * texel * row_length, row);
+
+  // pixels given twice before an upload only send the newer ones
+  VG_DestroyBuffer(k->wind, tex->staging);
+  tex->staging = staging;
+  if(!tex->queued) {
+    tex->queued = true;
+    k->numdirtytexs++;
+    k->dirtytexs = exalloc(k->dirtytexs, sizeof(OldskoolTexture*[k->numdirtytexs]), &k->dirtytexsize);
+    k->dirtytexs[k->numdirtytexs-1] = tex;
+  }
+  return 0;
+}
+
+// copies the queued textures' staging into level 0 and blits each level
+// down from the one above, or copies all the levels of a scalar texture,
+// leaving them all ready to sample
+static void osUploadTextures(OldskoolContext * k, VkCommandBuffer cmdbuf) {
+  for(int i = 0; i < k->numdirtytexs; i++) {
+    OldskoolTexture * tex = k->dirtytexs[i];
+    VkImage img = tex->storage.image.img;
+    // frames still sampling the old contents go first
+    VkImageMemoryBarrier barrier = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .srcAccessMask = 0,
+      .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+      .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = img,
+      .subresourceRange = {
+        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .baseMipLevel = 0,
+        .levelCount = tex->levels,
+        .layerCount = 1,
+      },
+    };
+    vkCmdPipelineBarrier(cmdbuf,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0,
+      0, NULL,
+      0, NULL,
+      1, &barrier
+    );
+    int copied = tex->format == OS_RGBA8 ? 1 : tex->levels;
+    VkBufferImageCopy regions[32];
+    VkDeviceSize offset = 0;
+    for(int level = 0; level < copied; level++) {
+      int w = osMipSize(tex->w, level), h = osMipSize(tex->h, level);
+      regions[level] = (VkBufferImageCopy) {
+        .bufferOffset = offset,
+        .imageSubresource = {
+          .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+          .mipLevel = level,
+          .layerCount = 1,
+        },
+        .imageExtent = { w, h, 1 },
+      };
+      offset += osTexelSize[tex->format] * w * h;
+    }
+    vkCmdCopyBufferToImage(cmdbuf, tex->staging.buf, img, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copied, regions);
+
+    int w = tex->w, h = tex->h;
+    barrier.subresourceRange.levelCount = 1;
+    for(int level = copied; level < tex->levels; level++) {
+      barrier.subresourceRange.baseMipLevel = level - 1;
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+      barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+      barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+      vkCmdPipelineBarrier(cmdbuf,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        1, &barrier
+      );
+      int nw = w > 1 ? w / 2 : 1;
+      int nh = h > 1 ? h / 2 : 1;
+      VkImageBlit blit = {
+        .srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, 1 },
+        .srcOffsets = { { 0, 0, 0 }, { w, h, 1 } },
+        .dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 },
+        .dstOffsets = { { 0, 0, 0 }, { nw, nh, 1 } },
+      };
+      vkCmdBlitImage(cmdbuf, img, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, img, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+      w = nw;
+      h = nh;
+    }
+
+    // every level but the last was blitted from, if any were blitted
+    int sources = copied < tex->levels ? tex->levels - 1 : 0;
+    VkImageMemoryBarrier done[2] = { barrier, barrier };
+    done[0].subresourceRange.baseMipLevel = 0;
+    done[0].subresourceRange.levelCount = sources;
+    done[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    done[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    done[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    done[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    done[1].subresourceRange.baseMipLevel = sources;
+    done[1].subresourceRange.levelCount = tex->levels - sources;
+    done[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    done[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    done[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    done[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(cmdbuf,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+      0,
+      0, NULL,
+      0, NULL,
+      sources > 0 ? 2 : 1, sources > 0 ? done : done + 1
+    );
+
+    // the staging copy is done with once this frame is
+    OldskoolStorage staging = { .buf = tex->staging };
+    osRetireStorage(k, &staging);
+    tex->staging = (VGBuffer) { VK_NULL_HANDLE, VK_NULL_HANDLE, 0 };
+    tex->queued = false;
+    tex->ready = true;
+  }
+  k->numdirtytexs = 0;
+}
+
+// copies all of buf into new storage on the transfer queue. whatever is
+// written meanwhile stays dirty and goes over once the copy has landed
+static int osStartUpload(OldskoolContext * k, OldskoolBuffer * buf) {
+  VGWindow * wind = k->wind;
+  OldskoolUpload up = { .buf = buf, .size = buf->size };
+  if(osAllocStorage(k, &up.storage, rounduppow2(buf->size), buf->usage))
+    return 1;
+  up.staging = VG_CreateBufferImpl(wind, buf->size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if(up.staging.buf == VK_NULL_HANDLE) {
+    osFreeStorage(k, &up.storage);
+    return 1;
+  }
+  memcpy(up.staging.map, buf->shadow, buf->size);
+
+  VkCommandBufferAllocateInfo allocInfo = {
+    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+    .commandPool = wind->transfer_pool,
+    .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+    .commandBufferCount = 1,
+  };
+  if(vkAllocateCommandBuffers(wind->device, &allocInfo, &up.cmdbuf) != VK_SUCCESS) {
+    VG_DestroyBuffer(wind, up.staging);
+    osFreeStorage(k, &up.storage);
+    return 1;
+  }
+  VkCommandBufferBeginInfo beginfo = {
+    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+    .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+  };
+  vkBeginCommandBuffer(up.cmdbuf, &beginfo);
+  VkBufferCopy region = { .srcOffset = 0, .dstOffset = 0, .size = buf->size };
+  vkCmdCopyBuffer(up.cmdbuf, up.staging.buf, up.storage.buf.buf, 1, &region);
+  // hand the storage over to the graphics queue, which takes it in
+  // osUploadBuffers with the matching barrier
+  VkBufferMemoryBarrier release = {
+    .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+    .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+    .dstAccessMask = 0,
+    .srcQueueFamilyIndex = wind->transfer_queue_index,
+    .dstQueueFamilyIndex = wind->graphics_queue_index,
+    .buffer = up.storage.buf.buf,
+    .offset = 0,
+    .size = VK_WHOLE_SIZE,
+  };
+  vkCmdPipelineBarrier(up.cmdbuf,
+    VK_PIPELINE_STAGE_TRANSFER_BIT,
+    VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+    0,
+    0, NULL,
+    1, &release,
+    0, NULL
+  );
+  if(vkEndCommandBuffer(up.cmdbuf) != VK_SUCCESS || VG_SubmitUpload(wind, up.cmdbuf, &up.value)) {
+    osFreeUpload(k, &up);
+    return 1;
+  }
+
+  k->numuploads++;
+  k->uploads = exalloc(k->uploads, sizeof(OldskoolUpload[k->numuploads]), &k->uploadsize);
+  k->uploads[k->numuploads-1] = up;
+  buf->pending = true;
+  buf->unchanged = buf->size;
+  buf->numdirty = 0;
+  return 0;
+}
+
+// swaps in the storage of uploads that have landed
+static void osFinishUploads(OldskoolContext * k, VkCommandBuffer cmdbuf) {
+  VGWindow * wind = k->wind;
+  int numleft = 0;
+  for(int i = 0; i < k->numuploads; i++) {
+    OldskoolUpload up = k->uploads[i];
+    if(!VG_UploadDone(wind, up.value)) {
+      k->uploads[numleft++] = up;
+      continue;
+    }
+    if(up.buf) {
+      VkBufferMemoryBarrier acquire = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+        .srcQueueFamilyIndex = wind->transfer_queue_index,
+        .dstQueueFamilyIndex = wind->graphics_queue_index,
+        .buffer = up.storage.buf.buf,
+        .offset = 0,
+        .size = VK_WHOLE_SIZE,
+      };
+      vkCmdPipelineBarrier(cmdbuf,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0, NULL,
+        1, &acquire,
+        0, NULL
+      );
+      VG_TakeUpload(wind, up.value);
+
+      OldskoolBuffer * buf = up.buf;
+      osRetireStorage(k, &buf->storage);
+      buf->storage = up.storage;
+      // anything written since the copy started is still dirty and goes
+      // over later, it doesn't count as uploaded till then
+      size_t good = up.size < buf->unchanged ? up.size : buf->unchanged;
+      buf->uploaded = good < buf->size ? good : buf->size;
+      buf->pending = false;
+      up.storage = (OldskoolStorage) { { VK_NULL_HANDLE, VK_NULL_HANDLE, 0 } };
+    }
+    osFreeUpload(k, &up);
+  }
+  k->numuploads = numleft;
+}
+
+int osUploadsPending(OldskoolContext * k) {
+  int pending = 0;
+  for(int i = 0; i < k->numuploads; i++)
+    pending += !VG_UploadDone(k->wind, k->uploads[i].value);
+  return pending;
+}
+
+void osUploadBuffers(OldskoolContext * k, VkCommandBuffer cmdbuf) {
+  osFinishUploads(k, cmdbuf);
+  osUploadTextures(k, cmdbuf);
+
+  size_t total = 0;
+  for(int i = 0; i < k->numdirtybufs; i++) {
+    OldskoolBuffer * buf = k->dirtybufs[i];
+    size_t dirty = 0;
+    for(int j = 0; j < buf->numdirty; j++)
+      dirty += buf->dirty[j].hi - buf->dirty[j].lo;
+    // big ones are left to the transfer queue when there is one, the frame
+    // goes on drawing the old contents
+    if(!buf->pending && dirty >= OS_ASYNC_UPLOAD && k->wind->transfer_queue != VK_NULL_HANDLE)
+      osStartUpload(k, buf);
+    if(!buf->pending)
+      total += dirty;
+  }
+  if(total == 0) {
+    int numleft = 0;
+    for(int i = 0; i < k->numdirtybufs; i++) {
+      OldskoolBuffer * buf = k->dirtybufs[i];
+      if(buf->pending)
+        k->dirtybufs[numleft++] = buf;
+      else
+        buf->queued = false;
+    }
+    k->numdirtybufs = numleft;
+    return;
+  }
+
+  OldskoolStorage staging = { { VK_NULL_HANDLE, VK_NULL_HANDLE, 0 } };
+  staging.buf = VG_CreateTransientBuffer(k->wind, total, VK_BUFFER_USAGE_TRANSFER_SRC_BIT);
+  if(staging.buf.buf == VK_NULL_HANDLE) {
+    // leave everything dirty and try again next frame
+    fprintf(stderr, "failed to create staging buffer\n");
+    return;
+  }
+  staging.map = staging.buf.map;
+
+  // earlier frames may still be reading what we're about to overwrite, or
+  // have uploads of their own outstanding
+  VkMemoryBarrier barrier = {
+    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+    .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+    .dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+  };
+  vkCmdPipelineBarrier(cmdbuf,
+    VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+    VK_PIPELINE_STAGE_TRANSFER_BIT,
+    0,
+    1, &barrier,
+    0, NULL,
+    0, NULL
+  );
+
+  // grow storage first, carrying over what the gpu already has
+  bool grew = false;
+  for(int i = 0; i < k->numdirtybufs; i++) {
+    OldskoolBuffer * buf = k->dirtybufs[i];
+    if(buf->pending || buf->size <= buf->storage.buf.size)
+      continue;
+    OldskoolStorage grown;
+    if(osAllocStorage(k, &grown, rounduppow2(buf->size), buf->usage)) {
+      fprintf(stderr, "failed to grow buffer\n");
+      continue;
+    }
+    if(buf->uploaded) {
+      VkBufferCopy region = { .srcOffset = 0, .dstOffset = 0, .size = buf->uploaded };
+      vkCmdCopyBuffer(cmdbuf, buf->storage.buf.buf, grown.buf.buf, 1, &region);
+      grew = true;
+    }
+    osRetireStorage(k, &buf->storage);
+    buf->storage = grown;
+  }
+  if(grew) {
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmdbuf,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0,
+      1, &barrier,
+      0, NULL,
+      0, NULL
+    );
+  }
+
+  size_t offset = 0;
+  int numleft = 0;
+  for(int i = 0; i < k->numdirtybufs; i++) {
+    OldskoolBuffer * buf = k->dirtybufs[i];
+    if(buf->pending || buf->size > buf->storage.buf.size) {
+      // couldn't grow it or it's on the transfer queue, keep it queued
+      k->dirtybufs[numleft++] = buf;
+      continue;
+    }
+    buf->queued = false;
+
+    VkBufferCopy regions[OS_MAX_DIRTY];
+    for(int j = 0; j < buf->numdirty; j++) {
+      OldskoolRange r = buf->dirty[j];
+      memcpy(staging.map + offset, buf->shadow + r.lo, r.hi - r.lo);
+      regions[j] = (VkBufferCopy) {
+        .srcOffset = offset,
+        .dstOffset = r.lo,
+        .size = r.hi - r.lo,
+      };
+      offset += r.hi - r.lo;
+    }
+    if(buf->numdirty)
+      vkCmdCopyBuffer(cmdbuf, staging.buf.buf, buf->storage.buf.buf, buf->numdirty, regions);
+    buf->numdirty = 0;
+    buf->uploaded = buf->size;
+  }
+  k->numdirtybufs = numleft;
+
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+  vkCmdPipelineBarrier(cmdbuf,
+    VK_PIPELINE_STAGE_TRANSFER_BIT,
+    VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+    0,
+    1, &barrier,
+    0, NULL,
+    0, NULL
+  );
+
+  // the staging copy is done with once this frame is
+  osRetireStorage(k, &staging);
+}
 
-  VkDeviceSize offset = 0;
-  if(k->numverts)
-    vkCmdBindVertexBuffers(cmdbuf, 0, 1, &k->vertbuf[parity].buf, &offset);
-  if(k->numinds)
-    vkCmdBindIndexBuffer(cmdbuf, k->indbuf[parity].buf, 0, VK_INDEX_TYPE_UINT32);
-  for(int i = 0; i < k->numcmds; i++) {
-    OldskoolCmd cmd = k->cmds[i];
+// the commands of a frame or of a display list. list commands carry the
+// matrix they were called with, which their own matrices are relative to
+static void osRecordCmds(OldskoolContext * k, VkCommandBuffer cmdbuf, OldskoolBinds * b, OldskoolCmd * cmds, int numcmds, OldskoolStream * vstream, OldskoolStream * istream, const mat4 * callmat) {
+  for(int i = 0; i < numcmds; i++) {
+    OldskoolCmd cmd = cmds[i];
     switch(cmd.type) {
       case OS_DRAW_ARRAYS:
+      case OS_DRAW_ELEMENTS:
       {
-        vkCmdDraw(cmdbuf, cmd.draw.count, 1, cmd.draw.start, 0);
+        int pipeprim = cmd.draw.prim == OS_QUADS ? OS_TRIANGLES : cmd.draw.prim;
+        if(b->pipeline != k->pipes[cmd.draw.format][pipeprim].pipeline) {
+          b->pipeline = k->pipes[cmd.draw.format][pipeprim].pipeline;
+          vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, b->pipeline);
+        }
+        if(b->vbuf != vstream->blocks[cmd.draw.block].buf.buf) {
+          VkDeviceSize offset = 0;
+          b->vbuf = vstream->blocks[cmd.draw.block].buf.buf;
+          vkCmdBindVertexBuffers(cmdbuf, 0, 1, &b->vbuf, &offset);
+        }
+        if(cmd.draw.format == OS_V2F && memcmp(&b->color, &cmd.draw.color, sizeof b->color)) {
+          b->color = cmd.draw.color;
+          vkCmdPushConstants(cmdbuf, b->layout, VK_SHADER_STAGE_VERTEX_BIT, offsetof(OldskoolPushConstants, color), sizeof(vec4), &b->color);
+        }
+        if(cmd.draw.prim == OS_POINTS && b->point_size != cmd.draw.point_size) {
+          b->point_size = cmd.draw.point_size;
+          vkCmdPushConstants(cmdbuf, b->layout, VK_SHADER_STAGE_VERTEX_BIT, offsetof(OldskoolPushConstants, point_size), sizeof(float), &b->point_size);
+        }
+        if(cmd.type == OS_DRAW_ARRAYS && cmd.draw.prim == OS_QUADS) {
+          // every batch reuses the same indices, offset by the base vertex
+          VkBuffer ibuf = k->quad_indices->storage.buf.buf;
+          if(ibuf == VK_NULL_HANDLE)
+            break;
+          if(b->ibuf != ibuf || b->indextype != VK_INDEX_TYPE_UINT16) {
+            b->ibuf = ibuf;
+            b->indextype = VK_INDEX_TYPE_UINT16;
+            vkCmdBindIndexBuffer(cmdbuf, b->ibuf, 0, b->indextype);
+          }
+          int quads = cmd.draw.count / 4;
+          for(int done = 0; done < quads; done += OS_QUAD_BATCH) {
+            int batch = quads - done < OS_QUAD_BATCH ? quads - done : OS_QUAD_BATCH;
+            vkCmdDrawIndexed(cmdbuf, 6 * batch, 1, 0, cmd.draw.start + 4 * done, 0);
+          }
+          break;
+        }
+        if(cmd.type == OS_DRAW_ARRAYS) {
+          vkCmdDraw(cmdbuf, cmd.draw.count, 1, cmd.draw.start, 0);
+          break;
+        }
+
+        VkBuffer ibuf = istream->blocks[cmd.draw.iblock].buf.buf;
+        VkIndexType indextype = cmd.draw.wide ? VK_INDEX_TYPE_UINT32 : VK_INDEX_TYPE_UINT16;
+        if(b->ibuf != ibuf || b->indextype != indextype) {
+          b->ibuf = ibuf;
+          b->indextype = indextype;
+          vkCmdBindIndexBuffer(cmdbuf, b->ibuf, 0, b->indextype);
+        }
+        vkCmdDrawIndexed(cmdbuf, cmd.draw.count, 1, cmd.draw.start, cmd.draw.base, 0);
         break;
       }
-      case OS_DRAW_ELEMENTS:
+      case OS_DRAW_LINE_STRIP:
+      {
+        OldskoolBuffer * points = cmd.strip.points;
+        OldskoolStorage * storage = &points->storage;
+        // points still on their way to the gpu are left for a later frame
+        size_t ongpu = points->usage == OS_STATIC_DRAW ? points->uploaded : points->size;
+        int ready = (int)(ongpu / sizeof(float[2])) - cmd.strip.first;
+        int count = cmd.strip.count < ready ? cmd.strip.count : ready;
+        int end = cmd.strip.part + cmd.strip.parts < count - 1 ? cmd.strip.part + cmd.strip.parts : count - 1;
+        if(end <= cmd.strip.part)
+          break;
+        if(b->pipeline != k->line_pipe.pipeline) {
+          b->pipeline = k->line_pipe.pipeline;
+          vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, b->pipeline);
+        }
+        if(b->set != storage->set) {
+          b->set = storage->set;
+          vkCmdBindDescriptorSets(cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, b->layout, 0, 1, &b->set, 0, NULL);
+        }
+
+        // the line is expanded in screen space, in the shader. smooth
+        // lines get a pixel more each side to fade out in
+        VkExtent2D extent = k->wind->swap_extent;
+        bool smooth = k->wind->msaa_samples <= 1;
+        float width = smooth ? cmd.strip.width + 2 : cmd.strip.width;
+        OldskoolPushConstants perdraw = {
+          .color = cmd.strip.color,
+          .line_size = { width / extent.width, width / extent.height },
+          .aspect = extent.width / (float) extent.height,
+          .first = cmd.strip.first,
+          .line_width = cmd.strip.width,
+        };
+        size_t pushoffset = offsetof(OldskoolPushConstants, color);
+        size_t pushend = offsetof(OldskoolPushConstants, point_size);
+        vkCmdPushConstants(cmdbuf, b->layout, VK_SHADER_STAGE_VERTEX_BIT, pushoffset, pushend - pushoffset, (char*)&perdraw + pushoffset);
+        if(smooth)
+          vkCmdPushConstants(cmdbuf, b->layout, VK_SHADER_STAGE_VERTEX_BIT, offsetof(OldskoolPushConstants, line_width), sizeof(float), &perdraw.line_width);
+        b->color = cmd.strip.color;
+
+        // the instance is the strip's last point, for the join at the end
+        vkCmdDraw(cmdbuf, 6 * (end - cmd.strip.part), 1, 6 * cmd.strip.part, cmd.strip.first + count - 1);
+        break;
+      }
+      case OS_DRAW_STRIPS:
+      {
+        OldskoolBuffer * draws = cmd.strips.draws;
+        VGPipeline pipe = k->strips_pipe;
+        if(b->pipeline != pipe.pipeline) {
+          b->pipeline = pipe.pipeline;
+          vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, b->pipeline);
+        }
+        // set 0 is laid out the same as every other pipeline's, set 1 is
+        // only this one's
+        VkDescriptorSet sets[] = { cmd.strips.points->storage.set, cmd.strips.series->storage.set };
+        vkCmdBindDescriptorSets(cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipe.layout, 0, 2, sets, 0, NULL);
+        b->set = sets[0];
+
+        VkExtent2D extent = k->wind->swap_extent;
+        bool smooth = k->wind->msaa_samples <= 1;
+        float width = smooth ? cmd.strips.width + 2 : cmd.strips.width;
+        OldskoolPushConstants perdraw = {
+          .line_size = { width / extent.width, width / extent.height },
+          .aspect = extent.width / (float) extent.height,
+          .line_width = cmd.strips.width,
+        };
+        size_t pushoffset = offsetof(OldskoolPushConstants, line_size);
+        size_t pushend = offsetof(OldskoolPushConstants, colormap);
+        vkCmdPushConstants(cmdbuf, b->layout, VK_SHADER_STAGE_VERTEX_BIT, pushoffset, pushend - pushoffset, (char*)&perdraw + pushoffset);
+        b->point_size = perdraw.point_size;
+
+        // the run's draws start after its count, padded out to 16 bytes
+        size_t stride = sizeof(VkDrawIndirectCommand);
+        VkDeviceSize offset = 16 * (VkDeviceSize)cmd.strips.slot;
+        if(k->wind->draw_indirect_count)
+          vkCmdDrawIndirectCount(cmdbuf, draws->storage.buf.buf, offset + 16, draws->storage.buf.buf, offset, cmd.strips.count, stride);
+        else
+          vkCmdDrawIndirect(cmdbuf, draws->storage.buf.buf, offset + 16, cmd.strips.count, stride);
+        break;
+      }
+      case OS_DRAW_TEXTURE:
+      {
+        OldskoolTexture * tex = cmd.texture.tex;
+        if(!tex->ready)
+          break;
+        bool scalar = cmd.texture.colormap >= 0;
+        VGPipeline pipe = scalar ? k->scalar_pipe : k->tex_pipe;
+        if(b->pipeline != pipe.pipeline) {
+          b->pipeline = pipe.pipeline;
+          vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, b->pipeline);
+        }
+        // set 0 is laid out differently from the other pipelines', the
+        // next draw that needs theirs binds it again
+        vkCmdBindDescriptorSets(cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipe.layout, 0, 1, &tex->storage.set, 0, NULL);
+        b->set = VK_NULL_HANDLE;
+
+        OldskoolPushConstants perdraw;
+        memcpy(perdraw.rect, &cmd.texture.rect, sizeof perdraw.rect);
+        memcpy(perdraw.uv, &cmd.texture.uv, sizeof perdraw.uv);
+        size_t pushoffset = offsetof(OldskoolPushConstants, rect);
+        size_t pushend = offsetof(OldskoolPushConstants, point_size);
+        vkCmdPushConstants(cmdbuf, b->layout, VK_SHADER_STAGE_VERTEX_BIT, pushoffset, pushend - pushoffset, (char*)&perdraw + pushoffset);
+        // that was over the color
+        b->color = make_vec4(NAN);
+        if(scalar) {
+          perdraw.colormap = cmd.texture.colormap;
+          perdraw.log_scale = cmd.texture.log_scale;
+          perdraw.range[0] = cmd.texture.range[0];
+          perdraw.range[1] = cmd.texture.range[1];
+          pushoffset = offsetof(OldskoolPushConstants, colormap);
+          vkCmdPushConstants(cmdbuf, b->layout, VK_SHADER_STAGE_FRAGMENT_BIT, pushoffset, sizeof perdraw - pushoffset, (char*)&perdraw + pushoffset);
+        }
+
+        vkCmdDraw(cmdbuf, 6, 1, 0, 0);
+        break;
+      }
+      case OS_DRAW_DENSITY:
       {
-        // FIXME instead of pre shifting indices, pass the shift here
-        vkCmdDrawIndexed(cmdbuf, cmd.draw.count, 1, cmd.draw.start, 0, 0);
+        OldskoolStorage * storage = &cmd.density.bins->storage;
+        if(storage->set == VK_NULL_HANDLE)
+          break;
+        if(b->pipeline != k->density_pipe.pipeline) {
+          b->pipeline = k->density_pipe.pipeline;
+          vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, b->pipeline);
+        }
+        if(b->set != storage->set) {
+          b->set = storage->set;
+          vkCmdBindDescriptorSets(cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, b->layout, 0, 1, &b->set, 0, NULL);
+        }
+
+        OldskoolPushConstants perdraw = {
+          .colormap = cmd.density.colormap,
+          .bins = { cmd.density.bins_x, cmd.density.bins_y },
+          .log_scale = cmd.density.log_scale,
+        };
+        size_t pushoffset = offsetof(OldskoolPushConstants, colormap);
+        vkCmdPushConstants(cmdbuf, b->layout, VK_SHADER_STAGE_FRAGMENT_BIT, pushoffset, sizeof perdraw - pushoffset, (char*)&perdraw + pushoffset);
+        vkCmdDraw(cmdbuf, 3, 1, 0, 0);
         break;
       }
       case OS_PUSHMAT:
       {
-        vkCmdPushConstants(cmdbuf, pipe.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(mat4), &cmd.matrix);
+        mat4 m = callmat ? mat4_mul(*callmat, cmd.matrix) : cmd.matrix;
+        vkCmdPushConstants(cmdbuf, b->layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(mat4), &m);
+        break;
+      }
+      case OS_CALL_LIST:
+      {
+        OldskoolList * list = cmd.call.list;
+        mat4 m = callmat ? mat4_mul(*callmat, cmd.call.matrix) : cmd.call.matrix;
+        osRecordCmds(k, cmdbuf, b, list->cmds, list->numcmds, &list->vstream, &list->istream, &m);
         break;
       }
       case OS_CLEARCOLOR:
@@ -439,34 +2122,77 @@ void osSubmit(OldskoolContext * k, VkCommandBuffer cmdbuf, bool parity) {
   }
 }
 
-static void * exalloc(void * ptr, size_t size, size_t *oldsize) {
-  if(size == 0) {
-    return ptr;
-  }
-  if(size <= *oldsize)
-    return ptr;
+void osSubmit(OldskoolContext * k, VkCommandBuffer cmdbuf, int slot) {
+  // this slot's last frame has been waited on, so storage retired by its
+  // last submit is no longer referenced by anything in flight
+  osFreeRetired(k, slot);
+  OldskoolStorage * tmp = k->retired[slot];
+  size_t tmpsize = k->retiredsize[slot];
+  k->retired[slot] = k->dead;
+  k->retiredsize[slot] = k->deadsize;
+  k->numretired[slot] = k->numdead;
+  k->dead = tmp;
+  k->deadsize = tmpsize;
+  k->numdead = 0;
+
+  assert(slot == k->slot);
+  assert(!k->recording);
+
+  // all oldskool pipelines share a layout
+  VGPipeline pipe = k->pipes[OS_C4F_V4F][OS_TRIANGLES];
+  mat4 id = mat4_id();
+  vkCmdPushConstants(cmdbuf, pipe.layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(mat4), &id);
 
-  size--;
-  size |= size >> 1;
-  size |= size >> 2;
-  size |= size >> 4;
-  size |= size >> 8;
-  size |= size >> 16;
-  size |= size >> 32;
-  size++;
+  vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipe.pipeline);
+  OldskoolBinds binds = {
+    .layout = pipe.layout,
+    .pipeline = pipe.pipeline,
+    .set = VK_NULL_HANDLE,
+    .vbuf = VK_NULL_HANDLE,
+    .ibuf = VK_NULL_HANDLE,
+    .indextype = VK_INDEX_TYPE_UINT16,
+    // nan so the first draw always pushes
+    .color = make_vec4(NAN),
+    .point_size = NAN,
+  };
 
-  *oldsize = size;
+  VkViewport viewport = {
+    .x = 0,
+    .y = 0,
+    .width = k->wind->swap_extent.width,
+    .height = k->wind->swap_extent.height,
+    .minDepth = 0,
+    .maxDepth = 1,
+  };
+  VkRect2D scissor = {
+    .offset = { 0, 0 },
+    .extent = k->wind->swap_extent,
+  };
+  vkCmdSetViewport(cmdbuf, 0, 1, &viewport);
+  vkCmdSetScissor(cmdbuf, 0, 1, &scissor);
 
-  return realloc(ptr, size);
+  osRecordCmds(k, cmdbuf, &binds, k->cmds, k->numcmds, &k->vstream[slot], &k->istream[slot], NULL);
 }
 
-void osReset(OldskoolContext * k) {
+void osReset(OldskoolContext * k, int slot) {
+  assert(!k->recording);
   k->state = OS_IDLE;
   k->start = 0;
+
+  // the caller has waited on this slot's last frame, its blocks are free again
+  assert(0 <= slot && slot < VG_MAX_FRAMES);
+  k->slot = slot;
+  k->vblock = 0;
   k->numverts = 0;
+  k->vertcap = 0;
+  k->verts = NULL;
+  k->iblock = 0;
   k->numinds = 0;
+  k->indcap = 0;
+  k->inds = NULL;
+
   k->numcmds = 0;
-  k->active_color = make_vec4(0, 0, 0, 1);
+  osColor4(k, make_vec4(0, 0, 0, 1));
 
   k->arrays_changed = true;
   k->arrays[0].data = NULL;
@@ -490,14 +2216,20 @@ void osClearColor(OldskoolContext * k, vec4 color) {
 }
 
 void osBegin(OldskoolContext * k, int primtype) {
-  assert(primtype == OS_TRIANGLES);
+  assert(OS_POINTS <= primtype && primtype < OS_NUM_PRIMS);
   assert(k->state == OS_IDLE);
 
   k->start = k->numverts;
-  k->active_color = make_vec4(0, 0, 0, 1);
+  osColor4(k, make_vec4(0, 0, 0, 1));
   k->state = primtype;
 }
 
+void osVertexFormat(OldskoolContext * k, int format) {
+  assert(k->state == OS_IDLE);
+  assert(0 <= format && format < OS_NUM_FORMATS);
+  osStreamFormat(k, format);
+}
+
 static void osUploadMatrix(OldskoolContext * k) {
   mat4 m = k->matstack[k->nummats-1];
   if(memcmp(&m, &k->lastmat, sizeof m)) {
@@ -513,8 +2245,9 @@ static void osUploadMatrix(OldskoolContext * k) {
   }
 }
 
-void osEnd(OldskoolContext * k) {
-  assert(k->state != OS_IDLE);
+static void osEmitBegun(OldskoolContext * k, int end) {
+  if(end == k->start)
+    return;
 
   osUploadMatrix(k);
 
@@ -522,26 +2255,106 @@ void osEnd(OldskoolContext * k) {
     .type = OS_DRAW_ARRAYS,
     .draw = {
       .prim = k->state,
+      .format = k->format,
       .start = k->start,
-      .count = k->numverts - k->start,
+      .count = end - k->start,
+      .block = k->vblock,
+      .color = k->active_color,
+      .point_size = k->point_size,
     },
   };
   k->numcmds++;
   k->cmds = exalloc(k->cmds, sizeof(OldskoolCmd[k->numcmds]), &k->cmdsize);
   k->cmds[k->numcmds-1] = cmd;
+}
+
+void osEnd(OldskoolContext * k) {
+  assert(k->state != OS_IDLE);
+
+  osEmitBegun(k, k->numverts);
 
   k->state = OS_IDLE;
 }
 
+// where an osBegin can be cut into two draws. everything before end can be
+// drawn now, and the returned number of vertices at the end of the begun
+// vertices have to start the next draw: the partial primitive of a list, or
+// the vertices a strip continues from
+static int osSplitBegun(OldskoolContext * k, int * end) {
+  int n = k->numverts - k->start;
+  int carry;
+  switch(k->state) {
+    case OS_LINE_STRIP:
+    case OS_TRIANGLE_STRIP:
+    {
+      int overlap = k->state == OS_LINE_STRIP ? 1 : 2;
+      carry = n < overlap ? n : overlap;
+      *end = n > overlap ? k->numverts : k->start;
+      break;
+    }
+    case OS_POINTS:
+      carry = 0;
+      *end = k->numverts;
+      break;
+    case OS_LINES:
+      carry = n % 2;
+      *end = k->numverts - carry;
+      break;
+    case OS_QUADS:
+      carry = n % 4;
+      *end = k->numverts - carry;
+      break;
+    default:
+      carry = n % 3;
+      *end = k->numverts - carry;
+      break;
+  }
+  return carry;
+}
+
+// the current block can't fit count more vertices partway through an osBegin.
+// draw what can be drawn and carry the rest over to the next block. culling
+// is off, so a triangle strip restarted on an odd vertex flipping winding is fine
+static void osSpillBegun(OldskoolContext * k, int count) {
+  int end;
+  int carry = osSplitBegun(k, &end);
+  osEmitBegun(k, end);
+
+  size_t stride = osFormatStride[k->format];
+  OldskoolVert partial[3];
+  if(carry)
+    memcpy(partial, k->verts + (k->numverts - carry) * stride, carry * stride);
+  k->numverts = end;
+  k->start = end;
+  assert(!osVertSpace(k, carry + count));
+  k->start = k->numverts;
+  if(carry)
+    memcpy(k->verts + k->numverts * stride, partial, carry * stride);
+  k->numverts += carry;
+}
+
 void osVertex4(OldskoolContext * k, vec4 v) {
   assert(k->state != OS_IDLE);
 
-  k->numverts++;
-  k->verts = exalloc(k->verts, sizeof(OldskoolVert[k->numverts]), &k->vertsize);
-  k->verts[k->numverts-1] = (OldskoolVert) {
-    .pos = v,
-    .color = k->active_color,
-  };
+  if(k->numverts == k->vertcap)
+    osSpillBegun(k, 1);
+
+  void * out = k->verts + k->numverts++ * osFormatStride[k->format];
+  switch(k->format) {
+    case OS_C4F_V4F:
+      *(OldskoolVert*)out = (OldskoolVert) { v, k->active_color };
+      break;
+    case OS_C4UB_V2F:
+    {
+      OldskoolVertC4UB vert = { .x = vec4_getX(v), .y = vec4_getY(v) };
+      memcpy(vert.color, &k->active_rgba8, sizeof vert.color);
+      *(OldskoolVertC4UB*)out = vert;
+      break;
+    }
+    case OS_V2F:
+      *(OldskoolVert2*)out = (OldskoolVert2) { vec4_getX(v), vec4_getY(v) };
+      break;
+  }
 }
 
 void osVertex3(OldskoolContext * k, vec3 v) {
@@ -552,14 +2365,92 @@ void osVertex2(OldskoolContext * k, vec2 v) {
   osVertex4(k, make_vec4(v, 0, 1));
 }
 
+void * osReserve(OldskoolContext * k, int count) {
+  assert(k->state != OS_IDLE);
+  assert(count >= 0);
+
+  if(k->numverts + count > k->vertcap)
+    osSpillBegun(k, count);
+
+  void * ret = k->verts + k->numverts * osFormatStride[k->format];
+  k->numverts += count;
+  return ret;
+}
+
+void osVertexArray4(OldskoolContext * k, int count, const vec4 * v) {
+  if(k->format != OS_C4F_V4F) {
+    for(int i = 0; i < count; i++)
+      osVertex4(k, v[i]);
+    return;
+  }
+  vec4 color = k->active_color;
+  OldskoolVert * out = osReserve(k, count);
+  for(int i = 0; i < count; i++)
+    out[i] = (OldskoolVert) { v[i], color };
+}
+
+void osVertexArray2f(OldskoolContext * k, int count, const float * xs, const float * ys) {
+  switch(k->format) {
+    case OS_C4F_V4F:
+    {
+      vec4 color = k->active_color;
+      OldskoolVert * out = osReserve(k, count);
+      for(int i = 0; i < count; i++)
+        out[i] = (OldskoolVert) { make_vec4(xs[i], ys[i], 0, 1), color };
+      break;
+    }
+    case OS_C4UB_V2F:
+    {
+      OldskoolVertC4UB vert;
+      memcpy(vert.color, &k->active_rgba8, sizeof vert.color);
+      OldskoolVertC4UB * out = osReserve(k, count);
+      for(int i = 0; i < count; i++) {
+        vert.x = xs[i];
+        vert.y = ys[i];
+        out[i] = vert;
+      }
+      break;
+    }
+    case OS_V2F:
+    {
+      OldskoolVert2 * out = osReserve(k, count);
+      for(int i = 0; i < count; i++)
+        out[i] = (OldskoolVert2) { xs[i], ys[i] };
+      break;
+    }
+  }
+}
+
 void osColor4(OldskoolContext * k, vec4 v) {
+  // without per vertex color the draw so far keeps the old color
+  if(k->format == OS_V2F && k->state != OS_IDLE && memcmp(&v, &k->active_color, sizeof v)) {
+    int end;
+    int carry = osSplitBegun(k, &end);
+    osEmitBegun(k, end);
+    k->start = k->numverts - carry;
+  }
   k->active_color = v;
+
+  float c[4];
+  memcpy(c, &v, sizeof c);
+  uint8_t rgba[4];
+  for(int i = 0; i < 4; i++)
+    rgba[i] = c[i] <= 0 ? 0 : c[i] >= 1 ? 255 : (uint8_t)(c[i] * 255 + 0.5f);
+  memcpy(&k->active_rgba8, rgba, sizeof rgba);
 }
 
 void osColor3(OldskoolContext * k, vec3 v) {
   osColor4(k, make_vec4(v, 1));
 }
 
+void osLineWidth(OldskoolContext * k, float width) {
+  k->line_width = width;
+}
+
+void osPointSize(OldskoolContext * k, float size) {
+  k->point_size = size;
+}
+
 void osLoadMatrix(OldskoolContext * k, mat4 m) {
   k->nummats = 1;
   k->matstack = exalloc(k->matstack, sizeof(mat4[k->nummats]), &k->matsize);
@@ -634,24 +2525,32 @@ static void osUploadArrays(OldskoolContext * k) {
   if(k->arrays[OS_COLOR].data)
     assert(k->arrays[OS_VERTEX].count == k->arrays[OS_COLOR].count);
 
-  int start = k->numverts;
+  // arrays are always expanded to the full format
+  int format = k->format;
+  osStreamFormat(k, OS_C4F_V4F);
+
   int count = k->arrays[OS_VERTEX].count;
+  assert(!osVertSpace(k, count));
+  int start = k->numverts;
   k->numverts += count;
-  k->verts = exalloc(k->verts, sizeof(OldskoolVert[k->numverts]), &k->vertsize);
 
+  OldskoolVert * verts = (OldskoolVert*)k->verts + start;
   for(int i = 0; i < count; i++) {
-    k->verts[start + i].pos = osReadArray(&k->arrays[OS_VERTEX], i);
+    verts[i].pos = osReadArray(&k->arrays[OS_VERTEX], i);
     if(k->arrays[OS_COLOR].data)
-      k->verts[start + i].color = osReadArray(&k->arrays[OS_COLOR], i);
+      verts[i].color = osReadArray(&k->arrays[OS_COLOR], i);
     else
-      k->verts[start + i].color = make_vec4(1);
+      verts[i].color = make_vec4(1);
   }
   k->uploaded_array_start = start;
   k->uploaded_array_count = count;
+  k->uploaded_array_block = k->vblock;
+
+  osStreamFormat(k, format);
 }
 
 int osDrawArrays(OldskoolContext * k, int mode, int start, int count) {
-  assert(mode == OS_TRIANGLES);
+  assert(OS_POINTS <= mode && mode < OS_NUM_PRIMS);
   assert(k->state == OS_IDLE);
 
   osUploadArrays(k);
@@ -661,8 +2560,11 @@ int osDrawArrays(OldskoolContext * k, int mode, int start, int count) {
     .type = OS_DRAW_ARRAYS,
     .draw = {
       .prim = mode,
+      .format = OS_C4F_V4F,
       .start = k->uploaded_array_start + start,
       .count = count,
+      .block = k->uploaded_array_block,
+      .point_size = k->point_size,
     },
   };
   k->numcmds++;
@@ -672,32 +2574,165 @@ int osDrawArrays(OldskoolContext * k, int mode, int start, int count) {
 }
 
 int osDrawElements(OldskoolContext * k, int mode, int count, int type, void * buf) {
-  assert(mode == OS_TRIANGLES);
+  assert(OS_POINTS <= mode && mode < OS_NUM_PRIMS && mode != OS_QUADS);
   assert(k->state == OS_IDLE);
-  assert(type == OS_UNSIGNED_INT);
+  assert(type == OS_UNSIGNED_INT || type == OS_UNSIGNED_SHORT);
 
   osUploadArrays(k);
   osUploadMatrix(k);
 
-  int start = k->numinds;
-  k->numinds += count;
-  k->inds = exalloc(k->inds, sizeof(unsigned[k->numinds]), &k->indsize);
-
-  unsigned * indices = buf;
-
-  unsigned vertex_base = k->uploaded_array_start;
   unsigned vertex_count = k->uploaded_array_count;
+  unsigned restart = type == OS_UNSIGNED_SHORT ? 0xffff : OS_PRIMITIVE_RESTART;
   for(int i = 0; i < count; i++) {
-    assert(indices[i] < vertex_count);
-    k->inds[start + i] = indices[i] + vertex_base;
+    unsigned index = type == OS_UNSIGNED_SHORT ? ((uint16_t*)buf)[i] : ((unsigned*)buf)[i];
+    assert(index < vertex_count || (index == restart && (mode == OS_LINE_STRIP || mode == OS_TRIANGLE_STRIP)));
+  }
+
+  // the base vertex goes to the draw, so indices are copied as is. 32 bit
+  // indices are narrowed when the arrays fit below the 16 bit restart index
+  bool wide = type == OS_UNSIGNED_INT && vertex_count >= 0xffff;
+  if(wide)
+    k->numinds = (k->numinds + 1) & ~1;
+  int slots = wide ? 2 * count : count;
+  assert(!osIndSpace(k, slots));
+  int start = k->numinds;
+  k->numinds += slots;
+
+  if(type == OS_UNSIGNED_SHORT || wide) {
+    memcpy(k->inds + start, buf, sizeof(uint16_t[slots]));
+  } else {
+    unsigned * indices = buf;
+    for(int i = 0; i < count; i++)
+      k->inds[start + i] = indices[i] == OS_PRIMITIVE_RESTART ? 0xffff : indices[i];
   }
 
   OldskoolCmd cmd = {
     .type = OS_DRAW_ELEMENTS,
     .draw = {
       .prim = mode,
-      .start = start,
+      .format = OS_C4F_V4F,
+      .start = wide ? start / 2 : start,
+      .count = count,
+      .block = k->uploaded_array_block,
+      .iblock = k->iblock,
+      .base = k->uploaded_array_start,
+      .wide = wide,
+      .point_size = k->point_size,
+    },
+  };
+  k->numcmds++;
+  k->cmds = exalloc(k->cmds, sizeof(OldskoolCmd[k->numcmds]), &k->cmdsize);
+  k->cmds[k->numcmds-1] = cmd;
+  return 0;
+}
+
+int osDrawLineStrip(OldskoolContext * k, OldskoolBuffer * points, int first, int count, int part, int parts) {
+  assert(k->state == OS_IDLE);
+  assert(sizeof(float[2][first + count]) <= points->size);
+  assert(part >= 0);
+  if(parts < 1 || part >= count - 1)
+    return 0;
+
+  osUploadMatrix(k);
+
+  OldskoolCmd cmd = {
+    .type = OS_DRAW_LINE_STRIP,
+    .strip = {
+      .points = points,
+      .first = first,
+      .count = count,
+      .part = part,
+      .parts = parts,
+      .width = k->line_width,
+      .color = k->active_color,
+    },
+  };
+  k->numcmds++;
+  k->cmds = exalloc(k->cmds, sizeof(OldskoolCmd[k->numcmds]), &k->cmdsize);
+  k->cmds[k->numcmds-1] = cmd;
+  return 0;
+}
+
+size_t osStripDrawsSize(int count) {
+  return 16 + sizeof(VkDrawIndirectCommand[count]);
+}
+
+int osCullStrips(OldskoolContext * k, VkCommandBuffer cmdbuf, mat4 mvp, float margin_x, float margin_y, OldskoolBuffer * series, int first, int count, OldskoolBuffer * draws) {
+  assert(sizeof(OldskoolSeries[first + count]) <= series->size);
+  assert(count <= OS_MAX_STRIPS);
+  if(!k->wind->draw_indirect || series->queued || draws->queued)
+    return 1;
+
+  // last frame's draw may still be reading the commands. the ones left
+  // over have to be empty when the count can't be read off the gpu, and
+  // the runs drawn before first aren't drawn again so all of it goes
+  VkMemoryBarrier barrier = {
+    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+    .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+    .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT,
+  };
+  vkCmdPipelineBarrier(cmdbuf,
+    VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+    VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+    0,
+    1, &barrier,
+    0, NULL,
+    0, NULL
+  );
+  vkCmdFillBuffer(cmdbuf, draws->storage.buf.buf, 0, VK_WHOLE_SIZE, 0);
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(cmdbuf,
+    VK_PIPELINE_STAGE_TRANSFER_BIT,
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+    0,
+    1, &barrier,
+    0, NULL,
+    0, NULL
+  );
+
+  vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_COMPUTE, k->cull_pipe.pipeline);
+  VkDescriptorSet sets[] = { series->storage.set, draws->storage.set };
+  vkCmdBindDescriptorSets(cmdbuf, VK_PIPELINE_BIND_POINT_COMPUTE, k->cull_pipe.layout, 0, 2, sets, 0, NULL);
+  OldskoolCullConstants consts = {
+    .mvp = mvp,
+    .margin = { margin_x, margin_y },
+    .first = first,
+    .count = count,
+  };
+  vkCmdPushConstants(cmdbuf, k->cull_pipe.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof consts, &consts);
+  vkCmdDispatch(cmdbuf, 1, 1, 1);
+
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+  vkCmdPipelineBarrier(cmdbuf,
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+    VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+    0,
+    1, &barrier,
+    0, NULL,
+    0, NULL
+  );
+  return 0;
+}
+
+int osDrawStrips(OldskoolContext * k, OldskoolBuffer * points, OldskoolBuffer * series, OldskoolBuffer * draws, int slot, int count) {
+  assert(k->state == OS_IDLE);
+  assert(16 * (size_t)slot + osStripDrawsSize(count) <= draws->size);
+  if(count == 0)
+    return 0;
+
+  osUploadMatrix(k);
+
+  OldskoolCmd cmd = {
+    .type = OS_DRAW_STRIPS,
+    .strips = {
+      .points = points,
+      .series = series,
+      .draws = draws,
+      .slot = slot,
       .count = count,
+      .width = k->line_width,
     },
   };
   k->numcmds++;
@@ -705,3 +2740,325 @@ int osDrawElements(OldskoolContext * k, int mode, int count, int type, void * bu
   k->cmds[k->numcmds-1] = cmd;
   return 0;
 }
+
+static int osRecordTexture(OldskoolContext * k, OldskoolCmd cmd) {
+  assert(k->state == OS_IDLE);
+
+  osUploadMatrix(k);
+
+  k->numcmds++;
+  k->cmds = exalloc(k->cmds, sizeof(OldskoolCmd[k->numcmds]), &k->cmdsize);
+  k->cmds[k->numcmds-1] = cmd;
+  return 0;
+}
+
+int osDrawTexture(OldskoolContext * k, OldskoolTexture * tex, vec4 rect, vec4 uv) {
+  OldskoolCmd cmd = {
+    .type = OS_DRAW_TEXTURE,
+    .texture = {
+      .tex = tex,
+      .rect = rect,
+      .uv = uv,
+      .colormap = -1,
+    },
+  };
+  return osRecordTexture(k, cmd);
+}
+
+int osDrawScalarTexture(OldskoolContext * k, OldskoolTexture * tex, vec4 rect, vec4 uv, int colormap, bool log_scale, float lo, float hi) {
+  assert(0 <= colormap && colormap < OS_NUM_COLORMAPS);
+  OldskoolCmd cmd = {
+    .type = OS_DRAW_TEXTURE,
+    .texture = {
+      .tex = tex,
+      .rect = rect,
+      .uv = uv,
+      .colormap = colormap,
+      .log_scale = log_scale,
+      .range = { lo, hi },
+    },
+  };
+  return osRecordTexture(k, cmd);
+}
+
+// zeroes the bins for a compute pass to count into
+static void osClearBins(VkCommandBuffer cmdbuf, OldskoolBuffer * bins, int bins_x, int bins_y) {
+  // the last frame's density draw may still be reading the bins, and the
+  // points may have just been uploaded
+  VkMemoryBarrier barrier = {
+    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+    .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+    .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_READ_BIT,
+  };
+  vkCmdPipelineBarrier(cmdbuf,
+    VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+    VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+    0,
+    1, &barrier,
+    0, NULL,
+    0, NULL
+  );
+  vkCmdFillBuffer(cmdbuf, bins->storage.buf.buf, 0, sizeof(uint32_t[1 + bins_x * bins_y]), 0);
+
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(cmdbuf,
+    VK_PIPELINE_STAGE_TRANSFER_BIT,
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+    0,
+    1, &barrier,
+    0, NULL,
+    0, NULL
+  );
+}
+
+// makes the counts visible to osDrawDensity
+static void osFinishBins(VkCommandBuffer cmdbuf) {
+  VkMemoryBarrier barrier = {
+    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+    .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+    .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+  };
+  vkCmdPipelineBarrier(cmdbuf,
+    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+    VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+    0,
+    1, &barrier,
+    0, NULL,
+    0, NULL
+  );
+}
+
+// 65535 groups is all a dispatch is sure to get
+enum { OS_MAX_GROUPS = 65535 };
+
+int osBinPoints(OldskoolContext * k, VkCommandBuffer cmdbuf, mat4 mvp, OldskoolBuffer * bins, int bins_x, int bins_y, OldskoolBuffer * points, int first, int count) {
+  assert(sizeof(uint32_t[1 + bins_x * bins_y]) <= bins->size);
+  assert(sizeof(float[2][first + count]) <= points->size);
+  // not on the gpu yet, osUploadBuffers couldn't make room for them
+  if(bins->queued || points->queued)
+    return 1;
+
+  osClearBins(cmdbuf, bins, bins_x, bins_y);
+
+  vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_COMPUTE, k->bin_pipe.pipeline);
+  VkDescriptorSet sets[] = { points->storage.set, bins->storage.set };
+  vkCmdBindDescriptorSets(cmdbuf, VK_PIPELINE_BIND_POINT_COMPUTE, k->bin_pipe.layout, 0, 2, sets, 0, NULL);
+
+  enum { GROUP = 256 };
+  for(int done = 0; done < count; done += GROUP * OS_MAX_GROUPS) {
+    int n = count - done < GROUP * OS_MAX_GROUPS ? count - done : GROUP * OS_MAX_GROUPS;
+    OldskoolBinConstants consts = {
+      .mvp = mvp,
+      .bins = { bins_x, bins_y },
+      .first = first + done,
+      .count = n,
+    };
+    vkCmdPushConstants(cmdbuf, k->bin_pipe.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof consts, &consts);
+    vkCmdDispatch(cmdbuf, (n + GROUP - 1) / GROUP, 1, 1);
+  }
+
+  osFinishBins(cmdbuf);
+  return 0;
+}
+
+int osBinLines(OldskoolContext * k, VkCommandBuffer cmdbuf, mat4 mvp, OldskoolBuffer * bins, int bins_x, int bins_y, OldskoolBuffer * points, OldskoolBuffer * series, int count) {
+  assert(sizeof(uint32_t[1 + bins_x * bins_y]) <= bins->size);
+  assert(sizeof(int32_t[2][count]) <= series->size);
+  if(bins->queued || points->queued || series->queued)
+    return 1;
+
+  osClearBins(cmdbuf, bins, bins_x, bins_y);
+
+  vkCmdBindPipeline(cmdbuf, VK_PIPELINE_BIND_POINT_COMPUTE, k->dense_pipe.pipeline);
+  VkDescriptorSet sets[] = { points->storage.set, bins->storage.set, series->storage.set };
+  vkCmdBindDescriptorSets(cmdbuf, VK_PIPELINE_BIND_POINT_COMPUTE, k->dense_pipe.layout, 0, 3, sets, 0, NULL);
+
+  // counts are fixed point, with fewer fractional bits the more series
+  // there are so that all of them crossing one cell still fits a uint. half
+  // the range is left for the pieces of a series rounding up
+  float one = count <= 32768 ? 65536 : (float)((1u << 31) / count);
+
+  // columns across, series down
+  enum { GROUP = 64 };
+  for(int done = 0; done < count; done += OS_MAX_GROUPS) {
+    int n = count - done < OS_MAX_GROUPS ? count - done : OS_MAX_GROUPS;
+    OldskoolBinConstants consts = {
+      .mvp = mvp,
+      .bins = { bins_x, bins_y },
+      .first = done,
+      .count = n,
+      .one = one,
+    };
+    vkCmdPushConstants(cmdbuf, k->dense_pipe.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof consts, &consts);
+    vkCmdDispatch(cmdbuf, (bins_x + GROUP - 1) / GROUP, n, 1);
+  }
+
+  osFinishBins(cmdbuf);
+  return 0;
+}
+
+void osDrawDensity(OldskoolContext * k, OldskoolBuffer * bins, int bins_x, int bins_y, int colormap, bool log_scale) {
+  assert(k->state == OS_IDLE);
+  assert(0 <= colormap && colormap < OS_NUM_COLORMAPS);
+  assert(sizeof(uint32_t[1 + bins_x * bins_y]) <= bins->size);
+
+  OldskoolCmd cmd = {
+    .type = OS_DRAW_DENSITY,
+    .density = {
+      .bins = bins,
+      .bins_x = bins_x,
+      .bins_y = bins_y,
+      .colormap = colormap,
+      .log_scale = log_scale,
+    },
+  };
+  k->numcmds++;
+  k->cmds = exalloc(k->cmds, sizeof(OldskoolCmd[k->numcmds]), &k->cmdsize);
+  k->cmds[k->numcmds-1] = cmd;
+}
+
+static void osSwapCursor(OldskoolContext * k, OldskoolCursor * c) {
+  OldskoolCursor tmp = {
+    .format = k->format,
+    .vblock = k->vblock,
+    .numverts = k->numverts,
+    .vertcap = k->vertcap,
+    .verts = k->verts,
+    .iblock = k->iblock,
+    .numinds = k->numinds,
+    .indcap = k->indcap,
+    .inds = k->inds,
+
+    .numcmds = k->numcmds,
+    .cmdsize = k->cmdsize,
+    .cmds = k->cmds,
+
+    .lastmat = k->lastmat,
+    .nummats = k->nummats,
+    .matsize = k->matsize,
+    .matstack = k->matstack,
+  };
+  k->format = c->format;
+  k->vblock = c->vblock;
+  k->numverts = c->numverts;
+  k->vertcap = c->vertcap;
+  k->verts = c->verts;
+  k->iblock = c->iblock;
+  k->numinds = c->numinds;
+  k->indcap = c->indcap;
+  k->inds = c->inds;
+
+  k->numcmds = c->numcmds;
+  k->cmdsize = c->cmdsize;
+  k->cmds = c->cmds;
+
+  k->lastmat = c->lastmat;
+  k->nummats = c->nummats;
+  k->matsize = c->matsize;
+  k->matstack = c->matstack;
+  *c = tmp;
+}
+
+// hands a stream's blocks to the retired list, frames in flight may still
+// be drawing from them
+static void osRetireStream(OldskoolContext * k, OldskoolStream * stream) {
+  for(int i = 0; i < stream->numblocks; i++) {
+    OldskoolStorage storage = { stream->blocks[i].buf, stream->blocks[i].map, VK_NULL_HANDLE, VK_NULL_HANDLE };
+    osRetireStorage(k, &storage);
+  }
+  stream->numblocks = 0;
+}
+
+OldskoolList * osCreateList(OldskoolContext * k) {
+  OldskoolList * ret = malloc(sizeof(OldskoolList));
+  *ret = (OldskoolList) {
+    .vstream = { 0, 0, NULL },
+    .istream = { 0, 0, NULL },
+    .numcmds = 0,
+    .cmdsize = 0,
+    .cmds = NULL,
+  };
+  return ret;
+}
+
+void osDestroyList(OldskoolContext * k, OldskoolList * list) {
+  assert(k->recording != list);
+  osRetireStream(k, &list->vstream);
+  osRetireStream(k, &list->istream);
+  free(list->vstream.blocks);
+  free(list->istream.blocks);
+  free(list->cmds);
+  free(list);
+}
+
+void osNewList(OldskoolContext * k, OldskoolList * list) {
+  assert(k->state == OS_IDLE);
+  assert(!k->recording);
+
+  osRetireStream(k, &list->vstream);
+  osRetireStream(k, &list->istream);
+  list->numcmds = 0;
+
+  k->saved = (OldskoolCursor) {
+    .format = k->format,
+    .vblock = 0,
+    .numverts = 0,
+    .vertcap = 0,
+    .verts = NULL,
+    .iblock = 0,
+    .numinds = 0,
+    .indcap = 0,
+    .inds = NULL,
+
+    .numcmds = 0,
+    .cmdsize = list->cmdsize,
+    .cmds = list->cmds,
+
+    .nummats = 1,
+    .matsize = 0,
+    .matstack = NULL,
+  };
+  // matrices in the list are relative to the one it's called with
+  k->saved.matstack = exalloc(NULL, sizeof(mat4), &k->saved.matsize);
+  k->saved.matstack[0] = mat4_id();
+  memset(&k->saved.lastmat, -1, sizeof k->saved.lastmat);
+
+  osSwapCursor(k, &k->saved);
+  k->recording = list;
+  k->arrays_changed = true;
+}
+
+void osEndList(OldskoolContext * k) {
+  assert(k->state == OS_IDLE);
+  assert(k->recording);
+
+  OldskoolList * list = k->recording;
+  osSwapCursor(k, &k->saved);
+  k->recording = NULL;
+  k->arrays_changed = true;
+
+  list->numcmds = k->saved.numcmds;
+  list->cmdsize = k->saved.cmdsize;
+  list->cmds = k->saved.cmds;
+  free(k->saved.matstack);
+}
+
+void osCallList(OldskoolContext * k, OldskoolList * list) {
+  assert(k->state == OS_IDLE);
+  assert(k->recording != list);
+
+  OldskoolCmd cmd = {
+    .type = OS_CALL_LIST,
+    .call = {
+      .list = list,
+      .matrix = k->matstack[k->nummats-1],
+    },
+  };
+  k->numcmds++;
+  k->cmds = exalloc(k->cmds, sizeof(OldskoolCmd[k->numcmds]), &k->cmdsize);
+  k->cmds[k->numcmds-1] = cmd;
+
+  // the list leaves its own matrix pushed
+  memset(&k->lastmat, -1, sizeof k->lastmat);
+}
@@ -1,17 +1,48 @@
 #ifndef OLDSKOOL_GRAPHICS_H
 #define OLDSKOOL_GRAPHICS_H
+#include <stdint.h>
 #include "vector_math.h"
 #include "volk.h"
 
 typedef struct VGWindow VGWindow;
 
 typedef struct OldskoolContext OldskoolContext;
-enum { OS_IDLE, OS_POINTS, OS_LINES, OS_TRIANGLES };
+typedef struct OldskoolBuffer OldskoolBuffer;
+typedef struct OldskoolList OldskoolList;
+typedef struct OldskoolTexture OldskoolTexture;
+
+// vertex layouts of the immediate mode stream, named like glInterleavedArrays.
+// OS_V2F has no per vertex color, the active color applies to the whole draw.
+// osColor inside osBegin splits the draw, a partial primitive takes the new color
+enum { OS_C4F_V4F, OS_C4UB_V2F, OS_V2F, OS_NUM_FORMATS };
+
+typedef struct OldskoolVert {
+  vec4 pos;
+  vec4 color;
+} OldskoolVert;
+
+typedef struct OldskoolVertC4UB {
+  uint8_t color[4];
+  float x, y;
+} OldskoolVertC4UB;
+
+typedef struct OldskoolVert2 {
+  float x, y;
+} OldskoolVert2;
+
+// OS_QUADS is four vertices per quad, drawn as indexed triangles
+enum { OS_IDLE, OS_POINTS, OS_LINES, OS_TRIANGLES, OS_LINE_STRIP, OS_TRIANGLE_STRIP, OS_QUADS, OS_NUM_PRIMS };
+
+// in the indices of osDrawElements, ends the current strip and starts another.
+// 0xffff does the same for OS_UNSIGNED_SHORT indices
+#define OS_PRIMITIVE_RESTART 0xffffffffu
 
 OldskoolContext * osCreate(VGWindow * wind);
 void osDestroy(OldskoolContext * k);
 
-void osReset(OldskoolContext * k);
+// starts a new frame in the given slot, from VG_NextFrame. the slot's last
+// frame must be done
+void osReset(OldskoolContext * k, int slot);
 
 void osClearColor(OldskoolContext * k, vec4 color);
 
@@ -19,15 +50,35 @@ void osLoadMatrix(OldskoolContext * k, mat4 m);
 void osPushMatrix(OldskoolContext * k, mat4 m);
 void osPopMatrix(OldskoolContext * k);
 
+// defaults to OS_C4F_V4F, can't be changed inside osBegin
+void osVertexFormat(OldskoolContext * k, int format);
+
 void osBegin(OldskoolContext * k, int primtype);
 void osEnd(OldskoolContext * k);
 
-void osSubmit(OldskoolContext * k, VkCommandBuffer cmdbuf, bool parity);
+// records copies for everything written to static buffers since the last call.
+// must be called outside of a render pass, before osSubmit
+// static buffers with a lot to upload are copied on the transfer queue
+// instead, if the device has one, and show up in a later frame. till then
+// line strips only draw the points that made it
+void osUploadBuffers(OldskoolContext * k, VkCommandBuffer cmdbuf);
+// how many of those copies are still going
+int osUploadsPending(OldskoolContext * k);
+void osSubmit(OldskoolContext * k, VkCommandBuffer cmdbuf, int slot);
 
 void osVertex4(OldskoolContext * k, vec4 v);
 void osVertex3(OldskoolContext * k, vec3 v);
 void osVertex2(OldskoolContext * k, vec2 v);
 
+// bulk versions of osVertex, the capacity check happens once per call and
+// the active color is read once. osReserve hands back count vertices of the
+// current format for the caller to fill in, they are only valid until the
+// next osVertex or osEnd. keep reservations modest, each one has to fit in a
+// single block
+void * osReserve(OldskoolContext * k, int count);
+void osVertexArray4(OldskoolContext * k, int count, const vec4 * v);
+void osVertexArray2f(OldskoolContext * k, int count, const float * xs, const float * ys);
+
 void osColor4(OldskoolContext * k, vec4 v);
 void osColor3(OldskoolContext * k, vec3 v);
 
@@ -37,6 +88,109 @@ int osVertexPointer(OldskoolContext * k, int vector_width, int type, int count,
 int osColorPointer(OldskoolContext * k, int vector_width, int type, int count, int stride, void * data, int offset);
 
 int osDrawArrays(OldskoolContext * k, int mode, int start, int count);
+// indices are OS_UNSIGNED_INT or OS_UNSIGNED_SHORT and relative to the vertex arrays
 int osDrawElements(OldskoolContext * k, int mode, int count, int type, void * indices);
 
+// retained buffer objects, these survive osReset
+// static buffers live in device local memory and are uploaded by osUploadBuffers,
+// stream buffers are written straight into host visible memory. a static
+// buffer given no data starts out zeroed
+enum { OS_STATIC_DRAW, OS_STREAM_DRAW };
+
+OldskoolBuffer * osCreateBuffer(OldskoolContext * k, int usage);
+void osDestroyBuffer(OldskoolContext * k, OldskoolBuffer * buf);
+int osBufferData(OldskoolContext * k, OldskoolBuffer * buf, size_t size, const void * data);
+// sizes a static buffer only the gpu writes, with nothing to upload. its
+// contents are undefined until then, frames in flight keep the old ones
+int osBufferStorage(OldskoolContext * k, OldskoolBuffer * buf, size_t size);
+int osBufferSubData(OldskoolContext * k, OldskoolBuffer * buf, size_t offset, size_t size, const void * data);
+
+void osLineWidth(OldskoolContext * k, float width);
+// in pixels, for OS_POINTS
+void osPointSize(OldskoolContext * k, float size);
+
+// draws segments part to part + parts of a polyline of packed float xy
+// pairs, expanded into a thick line on the gpu. the rest of the polyline
+// still shapes the joins at their ends, so parts drawn one by one meet the
+// same as the whole line
+int osDrawLineStrip(OldskoolContext * k, OldskoolBuffer * points, int first, int count, int part, int parts);
+
+// many short line strips in a couple of commands. series has an
+// OldskoolSeries for each, with its bounds, color and points. the series
+// come in runs that are drawn in one go each, and run is where a series'
+// run starts in draws, in 16 byte slots: the first slot has how many draws
+// the run has and a slot for each of its series follows, so a run of count
+// series takes osStripDrawsSize(count) bytes. osCullStrips records a compute
+// pass outside the render pass that keeps the series from first to first +
+// count whose bounds, padded by margin in clip space, reach the screen, and
+// writes their runs' draws into draws, a static buffer, starting from the
+// first series of each run it's given. osDrawStrips draws count series of
+// the run at slot at the current line width. nonzero comes back from
+// osCullStrips if the buffers haven't made it to the gpu or the device
+// can't draw indirect, the strips have to go through osDrawLineStrip then
+enum { OS_MAX_STRIPS = 65535 };
+typedef struct OldskoolSeries {
+  float bounds[4];
+  float color[4];
+  int first;
+  int count;
+  int run;
+  int pad;
+} OldskoolSeries;
+size_t osStripDrawsSize(int count);
+int osCullStrips(OldskoolContext * k, VkCommandBuffer cmdbuf, mat4 mvp, float margin_x, float margin_y, OldskoolBuffer * series, int first, int count, OldskoolBuffer * draws);
+int osDrawStrips(OldskoolContext * k, OldskoolBuffer * points, OldskoolBuffer * series, OldskoolBuffer * draws, int slot, int count);
+
+// textures, sampled with a full mip chain. osTexImage hands over the
+// pixels of the whole image, row_length texels apart, which
+// osUploadBuffers copies in and makes the smaller levels of. the pixels of
+// the single channel formats are floats whichever one it is. nearest
+// textures show their texels as squares when magnified. osDrawTexture
+// draws the uv part of the texture over rect, both as x1 y1 x2 y2, with
+// the current matrix. the first row of pixels goes at y1 when uv is 0 0 1 1,
+// nothing is drawn till the pixels are uploaded. destroying a texture keeps
+// it around for the frames still using it.
+// the single channel formats are scalar textures, drawn by
+// osDrawScalarTexture colored with a density colormap, lo to hi spanning
+// it. log_scale spaces them logarithmically, lo has to be above 0 for that.
+// nan texels aren't drawn, nor do they spread into the smaller levels or
+// the filtering of their neighbours. OS_R32F can't always be filtered, see
+// osTexFormatFilters, OS_R16F always can
+enum { OS_RGBA8, OS_R32F, OS_R16F, OS_NUM_TEX_FORMATS };
+
+OldskoolTexture * osCreateTexture(OldskoolContext * k, int w, int h, int format, bool nearest);
+void osDestroyTexture(OldskoolContext * k, OldskoolTexture * tex);
+int osTexImage(OldskoolContext * k, OldskoolTexture * tex, int row_length, const void * pixels);
+bool osTexFormatFilters(OldskoolContext * k, int format);
+int osDrawTexture(OldskoolContext * k, OldskoolTexture * tex, vec4 rect, vec4 uv);
+int osDrawScalarTexture(OldskoolContext * k, OldskoolTexture * tex, vec4 rect, vec4 uv, int colormap, bool log_scale, float lo, float hi);
+
+// point density. osBinPoints counts the packed xy pairs of points falling in
+// each cell of a bins_x by bins_y grid over the screen, with a compute pass
+// recorded straight into cmdbuf outside of the render pass. bins is a
+// static buffer of 1 + bins_x * bins_y uints, the first being the biggest
+// count, and nonzero comes back if it or points haven't made it to the gpu.
+// osDrawDensity then colors the screen by the counts.
+// osBinLines fills the bins from many polylines at once instead, series
+// holding the first point and point count of each as int pairs. every
+// series adds the same weight to each column it crosses, split between the
+// cells by its length in them, so the counts are fixed point. the x of
+// each series has to go up
+enum { OS_GRAYS, OS_HOT, OS_VIRIDIS, OS_NUM_COLORMAPS };
+
+int osBinPoints(OldskoolContext * k, VkCommandBuffer cmdbuf, mat4 mvp, OldskoolBuffer * bins, int bins_x, int bins_y, OldskoolBuffer * points, int first, int count);
+int osBinLines(OldskoolContext * k, VkCommandBuffer cmdbuf, mat4 mvp, OldskoolBuffer * bins, int bins_x, int bins_y, OldskoolBuffer * points, OldskoolBuffer * series, int count);
+void osDrawDensity(OldskoolContext * k, OldskoolBuffer * bins, int bins_x, int bins_y, int colormap, bool log_scale);
+
+// display lists. everything drawn between osNewList and osEndList is kept
+// in the list instead of the frame, geometry included, and replayed by
+// osCallList without being tessellated or uploaded again. matrices in the
+// list are relative to the matrix at osCallList. buffer objects and
+// list contents are read when the frame is submitted
+OldskoolList * osCreateList(OldskoolContext * k);
+void osDestroyList(OldskoolContext * k, OldskoolList * list);
+void osNewList(OldskoolContext * k, OldskoolList * list);
+void osEndList(OldskoolContext * k);
+void osCallList(OldskoolContext * k, OldskoolList * list);
+
 #endif
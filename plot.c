@@ -8,8 +8,12 @@
 #include <fcntl.h>
 #include <signal.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <poll.h>
 #include <errno.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 #include <math.h>
 
 #include <SDL2/SDL.h>
@@ -29,12 +33,33 @@
 
 // call it in scheme
 
+// counters the child keeps for the parent, mapped shared before the fork.
+// pixels has room for the window at the size it was made, reads goes up
+// each time the child has answered a plot_read_pixels
+typedef struct PlotStats {
+  volatile unsigned long skipped_frames;
+  volatile unsigned long attachment_bytes;
+  volatile float gpu_ms;
+  volatile unsigned long reads;
+  volatile bool read_ok;
+  unsigned char pixels[];
+} PlotStats;
+
 struct Plot {
   bool alive;
   int pipe;
   int child;
+  int w, h;
+  PlotStats * stats;
 };
 
+static PlotStats * child_stats;
+static int child_w, child_h;
+
+static size_t stats_size(int w, int h) {
+  return sizeof(PlotStats) + 4 * (size_t)w * h;
+}
+
 static sig_atomic_t plot_running;
 static void handle_sigterm(int signal) {
   plot_running = 0;
@@ -44,6 +69,7 @@ typedef struct WindStatus {
   bool program_exit;
   bool minimized;
   bool needs_resize;
+  bool needs_redraw;
 } WindStatus;
 
 static void poll_events(VGWindow * wind, WindStatus * status) {
@@ -60,12 +86,18 @@ static void poll_events(VGWindow * wind, WindStatus * status) {
         case SDL_WINDOWEVENT_SIZE_CHANGED:
         case SDL_WINDOWEVENT_MAXIMIZED:
           status->needs_resize = true;
+          status->needs_redraw = true;
           break;
         case SDL_WINDOWEVENT_MINIMIZED:
           status->minimized = true;
           break;
         case SDL_WINDOWEVENT_RESTORED:
           status->minimized = false;
+          status->needs_redraw = true;
+          break;
+        case SDL_WINDOWEVENT_SHOWN:
+        case SDL_WINDOWEVENT_EXPOSED:
+          status->needs_redraw = true;
           break;
       }
     }
@@ -74,12 +106,20 @@ static void poll_events(VGWindow * wind, WindStatus * status) {
 
 static void child_loop(VGWindow * win, int pipe);
 Plot * make_plot(int w, int h) {
+  return make_plot_msaa(w, h, 16);
+}
+
+Plot * make_plot_msaa(int w, int h, int samples) {
 
   int fds[2];
   assert(pipe(fds) == 0);
   int read_end = fds[0];
   int write_end = fds[1];
   assert(fcntl(read_end, F_SETFL, O_NONBLOCK) == 0);
+
+  PlotStats * stats = mmap(NULL, stats_size(w, h), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  assert(stats != MAP_FAILED);
+  *stats = (PlotStats) { 0 };
   
   int child = fork();
 
@@ -91,6 +131,9 @@ Plot * make_plot(int w, int h) {
     plot->alive = true;
     plot->child = child;
     plot->pipe = write_end;
+    plot->w = w;
+    plot->h = h;
+    plot->stats = stats;
     return plot;
   } else {
     // child process
@@ -98,11 +141,14 @@ Plot * make_plot(int w, int h) {
     signal(SIGINT, SIG_IGN);
     plot_running = 1;
     signal(SIGTERM, handle_sigterm);
+    child_stats = stats;
+    child_w = w;
+    child_h = h;
 
     bool ok = true;
     ok &= !VG_Init();
     VGWindow * wind;
-    ok &= !!(wind = VG_CreateWindow(w, h));
+    ok &= !!(wind = VG_CreateWindow(w, h, samples > 1 ? samples : 1));
     ok &= !VG_CreateAppObjects(wind);
     ok &= !VG_CreateSwapchain(wind);
     if(!ok) {
@@ -133,23 +179,95 @@ void close_plot(Plot * plot) {
       errno = 0;
     }
   }
+  munmap(plot->stats, stats_size(plot->w, plot->h));
+}
+
+unsigned long plot_skipped_frames(Plot * plot) {
+  return plot->stats->skipped_frames;
+}
+unsigned long plot_attachment_bytes(Plot * plot) {
+  return plot->stats->attachment_bytes;
+}
+float plot_gpu_ms(Plot * plot) {
+  return plot->stats->gpu_ms;
 }
 
 typedef struct Point {
   float x;
   float y;
 } Point;
+typedef struct PlotView {
+  float minx, miny;
+  float maxx, maxy;
+} PlotView;
+
+// one level of a line strip's min/max pyramid, in the line points buffer
+// with its xs kept for finding what's in view. width is how far in x its
+// widest bucket goes
+typedef struct LineLod {
+  int first;
+  int ct;
+  float * xs;
+  float width;
+} LineLod;
 typedef struct Geometry {
   int ct;
   float * xs;
   float * ys;
+
+  // filled in by the child on read
+  float minx, miny;
+  float maxx, maxy;
+  int first;
+  bool monotonic;
+  // summed into the dense lines layer instead of drawn as a line
+  bool dense;
+  int num_lods;
+  LineLod * lods;
+  int grid_w, grid_h;
+  int * cells;
+  // which of the strip series it is, -1 when it's drawn on its own, and
+  // the run of them it's drawn with
+  int strip;
+  int run;
 } Geometry;
+typedef struct Density {
+  Geometry geos;
+  int bins_x;
+  int bins_y;
+  int colormap;
+
+  // filled in by the child, the bins are counted again when the view
+  // moves away from binned
+  OldskoolBuffer * bins;
+  PlotView binned;
+} Density;
+typedef struct DenseLines {
+  int bins_x;
+  int bins_y;
+  int colormap;
+} DenseLines;
 typedef struct Line {
   float x1;
   float y1;
   float x2;
   float y2;
+
+  // filled in by the child, where its ends are in line_points
+  int first;
 } Line;
+// one level of a bitmap's pyramid, each half the size of the one before. the
+// level is cut into tiles that only become textures once they're in view,
+// used has the tile_gen each was last wanted in
+typedef struct BitmapLevel {
+  int w, h;
+  // the first rows of the level made so far
+  unsigned char * bits;
+  int rows;
+  int tiles_x, tiles_y;
+  OldskoolTexture ** tiles;
+  unsigned * used;
+} BitmapLevel;
 typedef struct Bitmap {
   float x1;
   float y1;
@@ -160,19 +278,39 @@ typedef struct Bitmap {
 
   int w;
   int h;
+  // 4 for rgba8 pixels, 1 for plot_image_f32's floats, which are colored
+  // with colormap from vmin to vmax when drawn
   int num_channels;
-  //GLuint tex;
+  float vmin, vmax;
+  int colormap;
+
+  // filled in by the child, the levels past the first are made a bit at a
+  // time once the view zooms out far enough to want them
+  int num_levels;
+  BitmapLevel * levels;
 } Bitmap;
 
-enum plot_cmd_t { NULL_COMMAND, PLOT_POINT, PLOT_POINTS, PLOT_LINE, PLOT_LINES, PLOT_COLOR, PLOT_BITMAP, PLOT_CONTINUOUS, PLOT_CLEAR, PLOT_BEGIN_FRAME, PLOT_END_FRAME }; 
+enum plot_cmd_t { NULL_COMMAND, PLOT_POINT, PLOT_POINTS, PLOT_LINE, PLOT_LINES, PLOT_COLOR, PLOT_BITMAP, PLOT_CONTINUOUS, PLOT_CLEAR, PLOT_BEGIN_FRAME, PLOT_END_FRAME, PLOT_ACCUMULATE, PLOT_FRAME_BUDGET, PLOT_VIEW, PLOT_AUTOSCALE, PLOT_DEDUPE, PLOT_DENSITY, PLOT_DENSE_LINES, PLOT_FRAMES_IN_FLIGHT, PLOT_PRESENT_MODE, PLOT_LOW_LATENCY, PLOT_MAX_FPS, PLOT_IMAGE_RANGE, PLOT_READ_PIXELS }; 
 typedef struct PlotCommand {
   enum plot_cmd_t type;
   union {
     Point point;
     Line line;
     Geometry geos;
+    Density density;
+    DenseLines dense;
     Bitmap bitmap;
+    // vmin, vmax and colormap for the last scalar image
+    Bitmap range;
     vec3 color;
+    bool accumulate;
+    float budget;
+    PlotView view;
+    bool dedupe;
+    int frames;
+    int present_mode;
+    bool low_latency;
+    float max_fps;
   };
 } PlotCommand;
 static_assert(sizeof(PlotCommand) < PIPE_BUF);
@@ -253,6 +391,26 @@ void plot_point(Plot * plot, float x, float y) {
   write_cmd(&cmd, plot);
 }
 
+void plot_density(Plot * plot, int ct, float * xs, float * ys, int bins_x, int bins_y, int colormap) {
+  // a grid without cells has nothing to count into
+  if(bins_x <= 0 || bins_y <= 0)
+    return;
+  PlotCommand cmd = {
+    .type = PLOT_DENSITY,
+    .density = {
+      .geos = {
+        .ct = ct,
+      },
+      .bins_x = bins_x,
+      .bins_y = bins_y,
+      .colormap = colormap,
+    },
+  };
+  write_cmd(&cmd, plot);
+  write_big_data((char*)xs, sizeof(float[ct]), plot);
+  write_big_data((char*)ys, sizeof(float[ct]), plot);
+}
+
 void plot_line(Plot * plot, float x1, float y1, float x2, float y2) {
   PlotCommand cmd = {
     .type = PLOT_LINE,
@@ -307,10 +465,43 @@ void plot_bitmap_rgba8(Plot * plot, float x1, float y1, float x2, float y2, int
     }
   };
   write_cmd(&cmd, plot);
-  size_t size = 4 * w * h;
+  size_t size = 4 * (size_t)w * h;
   write_big_data((char*)bits, size, plot);
 }
 
+void plot_image_f32(Plot * plot, float x1, float y1, float x2, float y2, int w, int h, const float * data, float vmin, float vmax, int colormap) {
+  PlotCommand cmd = {
+    .type = PLOT_BITMAP,
+    .bitmap = {
+      .x1 = x1,
+      .y1 = y1,
+      .x2 = x2,
+      .y2 = y2,
+
+      .w = w,
+      .h = h,
+      .num_channels = 1,
+      .vmin = vmin,
+      .vmax = vmax,
+      .colormap = colormap,
+    }
+  };
+  write_cmd(&cmd, plot);
+  write_big_data((char*)data, sizeof(float) * w * h, plot);
+}
+
+void plot_image_range(Plot * plot, float vmin, float vmax, int colormap) {
+  PlotCommand cmd = {
+    .type = PLOT_IMAGE_RANGE,
+    .range = {
+      .vmin = vmin,
+      .vmax = vmax,
+      .colormap = colormap,
+    },
+  };
+  write_cmd(&cmd, plot);
+}
+
 void plot_continuous(Plot * plot) {
   PlotCommand cmd = {
     .type = PLOT_CONTINUOUS,
@@ -323,6 +514,75 @@ void plot_clear(Plot * plot) {
   };
   write_cmd(&cmd, plot);
 }
+void plot_accumulate(Plot * plot, bool on) {
+  PlotCommand cmd = {
+    .type = PLOT_ACCUMULATE,
+    .accumulate = on,
+  };
+  write_cmd(&cmd, plot);
+}
+void plot_frame_budget(Plot * plot, float ms) {
+  PlotCommand cmd = {
+    .type = PLOT_FRAME_BUDGET,
+    .budget = ms,
+  };
+  write_cmd(&cmd, plot);
+}
+void plot_view(Plot * plot, float minx, float miny, float maxx, float maxy) {
+  PlotCommand cmd = {
+    .type = PLOT_VIEW,
+    .view = { minx, miny, maxx, maxy },
+  };
+  write_cmd(&cmd, plot);
+}
+void plot_autoscale(Plot * plot) {
+  PlotCommand cmd = {
+    .type = PLOT_AUTOSCALE,
+  };
+  write_cmd(&cmd, plot);
+}
+void plot_dedupe(Plot * plot, bool on) {
+  PlotCommand cmd = {
+    .type = PLOT_DEDUPE,
+    .dedupe = on,
+  };
+  write_cmd(&cmd, plot);
+}
+void plot_dense_lines(Plot * plot, int bins_x, int bins_y, int colormap) {
+  PlotCommand cmd = {
+    .type = PLOT_DENSE_LINES,
+    .dense = { bins_x, bins_y, colormap },
+  };
+  write_cmd(&cmd, plot);
+}
+void plot_frames_in_flight(Plot * plot, int frames) {
+  PlotCommand cmd = {
+    .type = PLOT_FRAMES_IN_FLIGHT,
+    .frames = frames,
+  };
+  write_cmd(&cmd, plot);
+}
+void plot_present_mode(Plot * plot, int mode) {
+  PlotCommand cmd = {
+    .type = PLOT_PRESENT_MODE,
+    .present_mode = mode,
+  };
+  write_cmd(&cmd, plot);
+}
+void plot_low_latency(Plot * plot, bool on) {
+  PlotCommand cmd = {
+    .type = PLOT_LOW_LATENCY,
+    .low_latency = on,
+  };
+  write_cmd(&cmd, plot);
+}
+void plot_max_fps(Plot * plot, float fps) {
+  PlotCommand cmd = {
+    .type = PLOT_MAX_FPS,
+    .max_fps = fps,
+  };
+  write_cmd(&cmd, plot);
+}
 void plot_begin_frame(Plot * plot) {
   PlotCommand cmd = {
     .type = PLOT_BEGIN_FRAME,
@@ -335,56 +595,514 @@ void plot_end_frame(Plot * plot) {
   };
   write_cmd(&cmd, plot);
 }
+bool plot_read_pixels(Plot * plot, unsigned char * rgba) {
+  unsigned long reads = plot->stats->reads;
+  PlotCommand cmd = {
+    .type = PLOT_READ_PIXELS,
+  };
+  write_cmd(&cmd, plot);
+  while(plot->stats->reads == reads) {
+    if(!plot_alive(plot))
+      return false;
+    usleep(1000);
+  }
+  __sync_synchronize();
+  if(!plot->stats->read_ok)
+    return false;
+  memcpy(rgba, plot->stats->pixels, 4 * (size_t)plot->w * plot->h);
+  return true;
+}
 
 static size_t num_cmds = 0;
 static size_t len_cmds = 0;
 static PlotCommand * cmds = NULL;
 
-/*
-static GLuint load_bitmap(PlotCommand cmd, int pipe) {
-  assert(cmd.type == PLOT_BITMAP);
+// line strip and density points live on the gpu as packed xy pairs, appended
+// as they come in
+static OldskoolBuffer * line_points = NULL;
+static int num_line_points = 0;
+
+// how far drawing the commands into the frame image got, big scenes take
+// several frames and carry on from here. a coarse preview pass that only
+// draws every stride'th point goes first when there's a lot to draw
+typedef struct PlotProgress {
+  bool preview;
+  int stride;
+  size_t cmd;
+  int point;
+  vec3 color;
+} PlotProgress;
+
+// new commands arrived since the last frame
+static bool frame_dirty = true;
+
+// the frame image is kept between frames. while retained it holds the
+// commands up to progress drawn with drawn_view, in accumulate mode new
+// commands are drawn on top of it instead of starting over
+static bool accumulate = false;
+static bool retained = false;
+static PlotView drawn_view;
+static PlotProgress progress;
+// the retained image was drawn while big uploads were still on the
+// transfer queue, missing some of their points, or with bitmap tiles still
+// to be made
+static bool partial = false;
+
+// milliseconds of tessellation per frame before the rest is left for later
+static float frame_budget = 8;
+
+// the view is fitted to everything plotted unless one was given
+static bool fixed_view = false;
+static PlotView view_box;
+
+// points that wouldn't change any pixel are dropped when on
+static bool dedupe = false;
+
+// with low_latency nothing is left queued on the gpu when the commands are
+// read, so a frame shows what came in right before it was recorded.
+// max_fps holds the redraws back when it's above 0
+static bool low_latency = false;
+static float max_fps = 0;
+// the one asked for, the swapchain is only made again between frames as
+// the commands can be read while an image is held. -1 once it's done
+static int present_mode = -1;
+// a plot_read_pixels is waiting for everything to be drawn
+static bool read_wanted = false;
+static double last_frame = 0;
+// 100ms
+#define ACQUIRE_TIMEOUT 100000000
+
+// line strips plotted while dense_lines.bins_x is set go into one density
+// layer, drawn in place of the first of them. dense_series has the first
+// point and count of each, dense_drawn is how many the retained image has.
+// dense_bins has the first dense_binned_ct of them, counted for
+// dense_binned, and isn't drawn while that's 0
+static DenseLines dense_lines;
+static OldskoolBuffer * dense_bins = NULL;
+static OldskoolBuffer * dense_series = NULL;
+static int num_dense_series = 0;
+static size_t dense_cmd;
+static PlotView dense_binned;
+static int dense_binned_ct = 0;
+static int dense_drawn = 0;
+
+// short line strips go into strip_series with their bounds and color, and
+// are culled and drawn a whole run at a time by the gpu. a run is the
+// strips read one after another with nothing else drawn between them, so
+// drawing it where its first strip was keeps everything in order.
+// strips_drawn is how many the frame image has, strips_culled the first of
+// the ones strip_draws has draws for this frame or -1
+enum { STRIP_POINTS = 1024 };
+typedef struct StripRun {
+  int first;
+  int count;
+  // where its draws start in strip_draws, in OldskoolSeries.run slots
+  int slot;
+} StripRun;
+static OldskoolBuffer * strip_series = NULL;
+static OldskoolBuffer * strip_draws = NULL;
+static size_t strip_draws_size = 0;
+static size_t strip_draws_used = 0;
+static int num_strip_series = 0;
+static StripRun * strip_runs = NULL;
+static int num_strip_runs = 0;
+static int len_strip_runs = 0;
+static bool strip_run_open = false;
+static int strips_culled = -1;
+static int strips_drawn = 0;
+// the color strips read now will be drawn in
+static vec3 read_color;
+
+// bitmaps are cut into tiles of bitmap_tile texels a side, which become
+// textures a texel bigger each way. the extra texels are copied from the
+// neighbouring tiles so filtering carries on across the seams. tiles out of
+// view are let go while there are over TILE_BUDGET bytes of them. a frame
+// makes at most TILE_LOADS new tiles and reads LEVEL_TEXELS texels into
+// levels that aren't built yet, the rest waits for the frames after
+enum { BITMAP_TILE = 2048, TILE_LOADS = 4, LEVEL_TEXELS = 1 << 24 };
+#define TILE_BUDGET ((size_t)512 << 20)
+static int bitmap_tile = BITMAP_TILE - 2;
+// scalar images are OS_R16F where floats can't be filtered
+static int scalar_format = OS_R32F;
+static size_t tile_bytes = 0;
+static unsigned tile_gen = 0;
+
+// the texels of the level a tile's texture has, x0 y0 x1 y1, its own and
+// the border around them
+static void tile_texels(BitmapLevel * level, int tx, int ty, int r[4]) {
+  r[0] = tx * bitmap_tile - (tx > 0);
+  r[1] = ty * bitmap_tile - (ty > 0);
+  r[2] = (tx + 1) * bitmap_tile + 1;
+  r[3] = (ty + 1) * bitmap_tile + 1;
+  r[2] = r[2] < level->w ? r[2] : level->w;
+  r[3] = r[3] < level->h ? r[3] : level->h;
+}
+
+// of the bits read in and of the levels made from them. floats stay floats
+// on the cpu whatever the textures are
+static size_t bitmap_texel(Bitmap * bit) {
+  return bit->num_channels == 4 ? 4 : sizeof(float);
+}
+
+static int bitmap_format(Bitmap * bit) {
+  return bit->num_channels == 4 ? OS_RGBA8 : scalar_format;
+}
 
-  size_t size = 4 * cmd.bitmap.w * cmd.bitmap.h;
-  char * bits = read_big_data(size, pipe);
+// with its mip chain
+static size_t tile_size(Bitmap * bit, BitmapLevel * level, int tx, int ty) {
+  int r[4];
+  tile_texels(level, tx, ty, r);
+  size_t texel = bitmap_format(bit) == OS_R16F ? sizeof(uint16_t) : 4;
+  return texel * (r[3] - r[1]) * (r[2] - r[0]) * 4 / 3;
+}
 
-  GLuint tex;
-  glGenTextures(1, &tex);
-  glBindTexture(GL_TEXTURE_2D, tex);
-  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cmd.bitmap.w, cmd.bitmap.h, 0, GL_RGBA, GL_UNSIGNED_BYTE, bits);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  if(cmd.bitmap.nearest)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+static void drop_tile(OldskoolContext * osk, Bitmap * bit, BitmapLevel * level, int tx, int ty) {
+  OldskoolTexture ** tile = &level->tiles[ty * level->tiles_x + tx];
+  if(!*tile)
+    return;
+  osDestroyTexture(osk, *tile);
+  *tile = NULL;
+  tile_bytes -= tile_size(bit, level, tx, ty);
+}
 
-  glGenerateMipmap(GL_TEXTURE_2D);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  free(bits);
-  return tex;
+static void free_bitmap(OldskoolContext * osk, Bitmap * bit) {
+  for(int i = 0; i < bit->num_levels; i++) {
+    BitmapLevel * level = &bit->levels[i];
+    if(level->tiles)
+      for(int ty = 0; ty < level->tiles_y; ty++)
+        for(int tx = 0; tx < level->tiles_x; tx++)
+          drop_tile(osk, bit, level, tx, ty);
+    free(level->tiles);
+    free(level->used);
+    free(level->bits);
+  }
+  free(bit->levels);
 }
-*/
 
-static void wipe_cmds() {
+static void wipe_cmds(OldskoolContext * osk) {
   for(int i = 0; i < num_cmds; i++) {
     switch(cmds[i].type) {
       case PLOT_POINTS:
+        free(cmds[i].geos.xs);
+        free(cmds[i].geos.ys);
+        free(cmds[i].geos.cells);
+        break;
       case PLOT_LINES:
         free(cmds[i].geos.xs);
         free(cmds[i].geos.ys);
+        for(int j = 0; j < cmds[i].geos.num_lods; j++)
+          free(cmds[i].geos.lods[j].xs);
+        free(cmds[i].geos.lods);
+        break;
+      case PLOT_DENSITY:
+        free(cmds[i].density.geos.xs);
+        free(cmds[i].density.geos.ys);
+        osDestroyBuffer(osk, cmds[i].density.bins);
         break;
       case PLOT_BITMAP:
-        assert(0);
+        free_bitmap(osk, &cmds[i].bitmap);
         break;
       default:
         break;
     }
   }
   num_cmds = 0;
+  retained = false;
+
+  num_line_points = 0;
+  osBufferData(osk, line_points, 0, NULL);
+
+  num_dense_series = 0;
+  dense_binned_ct = 0;
+  osBufferData(osk, dense_series, 0, NULL);
+
+  num_strip_series = 0;
+  num_strip_runs = 0;
+  strip_run_open = false;
+  strip_draws_used = 0;
+  strips_drawn = 0;
+  read_color = make_vec3(0);
+  osBufferData(osk, strip_series, 0, NULL);
+}
+
+static float min(float a, float b) {
+  return a < b ? a : b;
+}
+
+static float max(float a, float b) {
+  return a >= b ? a : b;
+}
+
+// the pixels, and room for every level down to the one that fits in a tile
+static void read_bitmap(Bitmap * bit, int pipe) {
+  unsigned char * bits = (unsigned char*)read_big_data(bitmap_texel(bit) * bit->w * bit->h, pipe);
+  bit->num_levels = 0;
+  bit->levels = NULL;
+  if(bit->w <= 0 || bit->h <= 0) {
+    free(bits);
+    return;
+  }
+  int w = bit->w, h = bit->h;
+  bit->num_levels = 1;
+  while(w > bitmap_tile || h > bitmap_tile) {
+    w = (w + 1) / 2;
+    h = (h + 1) / 2;
+    bit->num_levels++;
+  }
+  bit->levels = calloc(bit->num_levels, sizeof(BitmapLevel));
+  bit->levels[0] = (BitmapLevel) { .w = bit->w, .h = bit->h, .bits = bits, .rows = bit->h };
+  for(int i = 1; i < bit->num_levels; i++) {
+    bit->levels[i].w = (bit->levels[i - 1].w + 1) / 2;
+    bit->levels[i].h = (bit->levels[i - 1].h + 1) / 2;
+  }
+}
+
+// each texel the average of the 2x2 below it, or of what's left of them at
+// an odd edge. nan floats are left out, and only make a nan when all four
+// are. the rows are made in order, the levels under it first, until
+// budget texels of them have been read, a row at least. true once the level
+// is all there
+static bool build_level(Bitmap * bit, int i, size_t * budget) {
+  BitmapLevel * level = &bit->levels[i];
+  if(level->rows == level->h)
+    return true;
+  BitmapLevel * src = &bit->levels[i - 1];
+  if(!build_level(bit, i - 1, budget))
+    return false;
+  size_t texel = bitmap_texel(bit);
+  if(!level->bits)
+    level->bits = malloc(texel * level->w * level->h);
+  for(; level->rows < level->h; level->rows++) {
+    if(*budget == 0)
+      return false;
+    size_t cost = 4 * (size_t)level->w;
+    *budget = cost < *budget ? *budget - cost : 0;
+    int y = level->rows;
+    const unsigned char * r0 = src->bits + texel * src->w * (2 * y);
+    const unsigned char * r1 = 2 * y + 1 < src->h ? r0 + texel * src->w : r0;
+    unsigned char * out = level->bits + texel * level->w * y;
+    for(int x = 0; x < level->w; x++) {
+      int x0 = 2 * x;
+      int x1 = 2 * x + 1 < src->w ? x0 + 1 : x0;
+      if(bit->num_channels == 1) {
+        const float * f0 = (const float*)r0, * f1 = (const float*)r1;
+        float v[4] = { f0[x0], f0[x1], f1[x0], f1[x1] };
+        float sum = 0;
+        int n = 0;
+        for(int c = 0; c < 4; c++) {
+          if(!isnan(v[c])) {
+            sum += v[c];
+            n++;
+          }
+        }
+        ((float*)out)[x] = n ? sum / n : NAN;
+        continue;
+      }
+      for(int c = 0; c < 4; c++)
+        out[4 * x + c] = (r0[4 * x0 + c] + r0[4 * x1 + c] + r1[4 * x0 + c] + r1[4 * x1 + c] + 2) / 4;
+    }
+  }
+  return true;
+}
+
+static void read_geometry(Geometry * geos, int pipe) {
+  geos->xs = (float*)read_big_data(sizeof(float[geos->ct]), pipe);
+  geos->ys = (float*)read_big_data(sizeof(float[geos->ct]), pipe);
+
+  geos->minx = INFINITY;
+  geos->miny = INFINITY;
+  geos->maxx = -INFINITY;
+  geos->maxy = -INFINITY;
+  for(int i = 0; i < geos->ct; i++) {
+    geos->minx = min(geos->minx, geos->xs[i]);
+    geos->miny = min(geos->miny, geos->ys[i]);
+    geos->maxx = max(geos->maxx, geos->xs[i]);
+    geos->maxy = max(geos->maxy, geos->ys[i]);
+  }
+}
+
+static void upload_points(OldskoolContext * osk, Geometry * geos) {
+  float (*points)[2] = malloc(sizeof(float[geos->ct][2]));
+  for(int i = 0; i < geos->ct; i++) {
+    points[i][0] = geos->xs[i];
+    points[i][1] = geos->ys[i];
+  }
+  geos->first = num_line_points;
+  osBufferSubData(osk, line_points, sizeof(float[num_line_points][2]), sizeof(float[geos->ct][2]), points);
+  num_line_points += geos->ct;
+  free(points);
+}
+
+// pyramid levels stop once there are this few buckets, no window is that narrow
+enum { LOD_MIN_BUCKETS = 512 };
+
+// m4 style min/max pyramid of a line strip. level l splits the strip into
+// buckets of 2^l points and keeps the first, lowest, highest and last point
+// of each in order, which draws the same envelope as the whole strip once a
+// bucket is narrower than a pixel. levels under 8 points a bucket don't
+// save anything and aren't kept
+static void build_line_lods(OldskoolContext * osk, Geometry * geos) {
+  geos->num_lods = 0;
+  geos->lods = NULL;
+  int ct = geos->ct;
+  const float * xs = geos->xs;
+  const float * ys = geos->ys;
+  // buckets only line up with pixel columns when x never goes back
+  geos->monotonic = true;
+  for(int i = 1; i < ct && geos->monotonic; i++)
+    geos->monotonic = xs[i] >= xs[i-1];
+  if(!geos->monotonic || ct / 8 < LOD_MIN_BUCKETS)
+    return;
+
+  // each bucket is the indices of its first, lowest, highest and last point
+  int nb = (ct + 1) / 2;
+  int (*buckets)[4] = malloc(sizeof(int[nb][4]));
+  for(int b = 0; b < nb; b++) {
+    int i = 2*b;
+    int j = i+1 < ct ? i+1 : i;
+    bool rising = ys[i] <= ys[j];
+    buckets[b][0] = i;
+    buckets[b][1] = rising ? i : j;
+    buckets[b][2] = rising ? j : i;
+    buckets[b][3] = j;
+  }
+
+  float (*points)[2] = NULL;
+  geos->lods = malloc(sizeof(LineLod[32]));
+  for(int level = 2; nb > LOD_MIN_BUCKETS; level++) {
+    int merged = (nb + 1) / 2;
+    for(int b = 0; b < merged; b++) {
+      int * l = buckets[2*b];
+      int * r = 2*b+1 < nb ? buckets[2*b+1] : l;
+      int lo = ys[r[1]] < ys[l[1]] ? r[1] : l[1];
+      int hi = ys[r[2]] > ys[l[2]] ? r[2] : l[2];
+      int last = r[3];
+      buckets[b][0] = l[0];
+      buckets[b][1] = lo;
+      buckets[b][2] = hi;
+      buckets[b][3] = last;
+    }
+    nb = merged;
+    if(level < 3)
+      continue;
+    if(!points)
+      points = malloc(sizeof(float[4*nb][2]));
+
+    int n = 0;
+    int prev = -1;
+    float width = 0;
+    float * lod_xs = malloc(sizeof(float[4*nb]));
+    for(int b = 0; b < nb; b++) {
+      int * q = buckets[b];
+      width = max(width, xs[q[3]] - xs[q[0]]);
+      int order[4] = { q[0], q[1] < q[2] ? q[1] : q[2], q[1] < q[2] ? q[2] : q[1], q[3] };
+      for(int k = 0; k < 4; k++) {
+        if(order[k] == prev)
+          continue;
+        prev = order[k];
+        points[n][0] = xs[prev];
+        points[n][1] = ys[prev];
+        lod_xs[n] = xs[prev];
+        n++;
+      }
+    }
+    geos->lods[geos->num_lods++] = (LineLod) { num_line_points, n, lod_xs, width };
+    osBufferSubData(osk, line_points, sizeof(float[num_line_points][2]), sizeof(float[n][2]), points);
+    num_line_points += n;
+  }
+  free(points);
+  free(buckets);
+}
+
+// the coarsest pyramid level of a strip whose buckets are all still
+// narrower than a pixel, or the strip itself. the widest bucket decides it,
+// with x spaced unevenly the average would let some span several pixels
+static LineLod line_level(const Geometry * geos, float pixel) {
+  LineLod level = { geos->first, geos->ct, geos->xs };
+  for(int i = 0; i < geos->num_lods; i++) {
+    if(geos->lods[i].width > pixel)
+      break;
+    level = geos->lods[i];
+  }
+  return level;
+}
+
+// scatter series this big get a uniform grid over their bounds, with the
+// points sorted into its cells row by row so the part of a series in view
+// is one index range per row of cells
+enum { GRID_MIN_POINTS = 16384, GRID_CELL_POINTS = 64, GRID_MAX_SIDE = 256 };
+
+static int grid_cell(float v, float lo, float hi, int n) {
+  float f = hi > lo ? (v - lo) / (hi - lo) * n : 0;
+  if(!(f >= 0))
+    return 0;
+  return f >= n ? n - 1 : (int)f;
+}
+
+static void build_point_grid(Geometry * geos) {
+  geos->cells = NULL;
+  int ct = geos->ct;
+  if(ct < GRID_MIN_POINTS)
+    return;
+  int side = sqrtf(ct / GRID_CELL_POINTS);
+  if(side > GRID_MAX_SIDE)
+    side = GRID_MAX_SIDE;
+  int w = side, h = side;
+
+  int * cell = malloc(sizeof(int[ct]));
+  int * starts = calloc(w*h + 1, sizeof(int));
+  for(int i = 0; i < ct; i++) {
+    cell[i] = grid_cell(geos->ys[i], geos->miny, geos->maxy, h) * w + grid_cell(geos->xs[i], geos->minx, geos->maxx, w);
+    starts[cell[i] + 1]++;
+  }
+  for(int c = 0; c < w*h; c++)
+    starts[c + 1] += starts[c];
+
+  int * next = malloc(sizeof(int[w*h]));
+  for(int c = 0; c < w*h; c++)
+    next[c] = starts[c];
+  float * xs = malloc(sizeof(float[ct]));
+  float * ys = malloc(sizeof(float[ct]));
+  for(int i = 0; i < ct; i++) {
+    int j = next[cell[i]]++;
+    xs[j] = geos->xs[i];
+    ys[j] = geos->ys[i];
+  }
+  free(next);
+  free(cell);
+  free(geos->xs);
+  free(geos->ys);
+  geos->xs = xs;
+  geos->ys = ys;
+  geos->grid_w = w;
+  geos->grid_h = h;
+  geos->cells = starts;
 }
 
 static bool continuous_draw = true;
 
-static void read_cmds(VGWindow * wind, WindStatus * status, int pipe) {
+// a frame is due every refresh of the display the window is on, the ones
+// that pass with nothing to draw count as skipped
+static double frame_due = 0;
+
+static double refresh_ms(VGWindow * wind) {
+  SDL_DisplayMode mode;
+  if(SDL_GetWindowDisplayMode(wind->window, &mode) == 0 && mode.refresh_rate > 0)
+    return 1000.0 / mode.refresh_rate;
+  return 1000.0 / 60;
+}
+
+// sleeps until commands arrive on the pipe, or briefly so window events
+// still get pumped
+static void wait_for_work(int pipe, int ms) {
+  struct pollfd pfd = {
+    .fd = pipe,
+    .events = POLLIN,
+  };
+  poll(&pfd, 1, ms);
+}
+
+static void read_cmds(VGWindow * wind, OldskoolContext * osk, WindStatus * status, int pipe) {
   PlotCommand cmd;
   bool done = false;
   while(!done) {
@@ -413,6 +1131,7 @@ static void read_cmds(VGWindow * wind, WindStatus * status, int pipe) {
       return;
     }
     assert(ret == sizeof cmd);
+    frame_dirty = true;
 
     if(!cmds) {
       len_cmds = 16;
@@ -426,48 +1145,186 @@ static void read_cmds(VGWindow * wind, WindStatus * status, int pipe) {
     switch(cmd.type) {
       case PLOT_CONTINUOUS:
         if(!continuous_draw)
-          wipe_cmds();
+          wipe_cmds(osk);
         continuous_draw = true;
         break;
       case PLOT_CLEAR:
-        wipe_cmds();
+        wipe_cmds(osk);
         break;
       case PLOT_BEGIN_FRAME:
-        wipe_cmds();
+        wipe_cmds(osk);
         continuous_draw = false;
         break;
       case PLOT_END_FRAME:
         done = true;
         break;
+      case PLOT_ACCUMULATE:
+        accumulate = cmd.accumulate;
+        break;
+      case PLOT_FRAME_BUDGET:
+        frame_budget = cmd.budget;
+        break;
+      case PLOT_VIEW:
+        fixed_view = true;
+        view_box = cmd.view;
+        break;
+      case PLOT_AUTOSCALE:
+        fixed_view = false;
+        break;
+      case PLOT_DEDUPE:
+        dedupe = cmd.dedupe;
+        break;
+      case PLOT_FRAMES_IN_FLIGHT:
+        VG_SetFramesInFlight(wind, cmd.frames);
+        break;
+      case PLOT_PRESENT_MODE:
+        if(cmd.present_mode >= 0 && cmd.present_mode <= PLOT_IMMEDIATE)
+          present_mode = cmd.present_mode;
+        break;
+      case PLOT_LOW_LATENCY:
+        low_latency = cmd.low_latency;
+        break;
+      case PLOT_MAX_FPS:
+        max_fps = cmd.max_fps;
+        break;
+      case PLOT_READ_PIXELS:
+        read_wanted = true;
+        break;
+      case PLOT_DENSE_LINES:
+        if(cmd.dense.bins_x > 0 && cmd.dense.bins_y > 0) {
+          osBufferData(osk, dense_bins, sizeof(uint32_t[1 + cmd.dense.bins_x * cmd.dense.bins_y]), NULL);
+          dense_binned = (PlotView) { NAN, NAN, NAN, NAN };
+          dense_binned_ct = 0;
+          dense_lines = cmd.dense;
+          // the layer already drawn is in the old bins and colors
+          retained = false;
+        } else {
+          dense_lines.bins_x = 0;
+        }
+        break;
 
       case PLOT_POINTS:
+        read_geometry(&cmd.geos, pipe);
+        build_point_grid(&cmd.geos);
+        cmds[num_cmds++] = cmd;
+        break;
+      case PLOT_COLOR:
+        read_color = cmd.color;
+        cmds[num_cmds++] = cmd;
+        break;
       case PLOT_LINES:
-        cmd.geos.xs = (float*)read_big_data(sizeof(float[cmd.geos.ct]), pipe);
-        cmd.geos.ys = (float*)read_big_data(sizeof(float[cmd.geos.ct]), pipe);
+        read_geometry(&cmd.geos, pipe);
+        upload_points(osk, &cmd.geos);
+        build_line_lods(osk, &cmd.geos);
+        // the binning shader needs x to go up, other strips stay lines
+        cmd.geos.dense = dense_lines.bins_x > 0 && cmd.geos.monotonic && cmd.geos.ct > 1;
+        if(cmd.geos.dense) {
+          if(num_dense_series == 0)
+            dense_cmd = num_cmds;
+          int32_t series[2] = { cmd.geos.first, cmd.geos.ct };
+          osBufferSubData(osk, dense_series, sizeof(int32_t[num_dense_series][2]), sizeof series, series);
+          num_dense_series++;
+        }
+        cmd.geos.strip = -1;
+        if(!cmd.geos.dense && cmd.geos.num_lods == 0 && cmd.geos.ct > 1 &&
+           cmd.geos.ct <= STRIP_POINTS && num_strip_series < OS_MAX_STRIPS) {
+          if(!strip_run_open) {
+            if(num_strip_runs >= len_strip_runs) {
+              len_strip_runs = len_strip_runs ? 2*len_strip_runs : 16;
+              strip_runs = realloc(strip_runs, sizeof(StripRun[len_strip_runs]));
+            }
+            strip_runs[num_strip_runs++] = (StripRun) { num_strip_series, 0, strip_draws_used / 16 };
+            strip_run_open = true;
+          }
+          StripRun * run = &strip_runs[num_strip_runs - 1];
+          OldskoolSeries series = {
+            .bounds = { cmd.geos.minx, cmd.geos.miny, cmd.geos.maxx, cmd.geos.maxy },
+            .color = { vec3_getX(read_color), vec3_getY(read_color), vec3_getZ(read_color), 1 },
+            .first = cmd.geos.first,
+            .count = cmd.geos.ct,
+            .run = run->slot,
+          };
+          osBufferSubData(osk, strip_series, sizeof(OldskoolSeries[num_strip_series]), sizeof series, &series);
+          cmd.geos.strip = num_strip_series++;
+          cmd.geos.run = num_strip_runs - 1;
+          run->count++;
+          strip_draws_used = 16 * (size_t)run->slot + osStripDrawsSize(run->count);
+          // only the gpu writes the draws, nothing to upload
+          if(strip_draws_used > strip_draws_size) {
+            strip_draws_size = 2 * strip_draws_used;
+            if(osBufferStorage(osk, strip_draws, strip_draws_size))
+              strip_draws_size = 0;
+          }
+        }
         cmds[num_cmds++] = cmd;
         break;
+      case PLOT_LINE:
+      {
+        // smooth lines are drawn as a strip of two
+        float points[2][2] = { { cmd.line.x1, cmd.line.y1 }, { cmd.line.x2, cmd.line.y2 } };
+        cmd.line.first = num_line_points;
+        osBufferSubData(osk, line_points, sizeof(float[num_line_points][2]), sizeof points, points);
+        num_line_points += 2;
+        cmds[num_cmds++] = cmd;
+        break;
+      }
+      case PLOT_DENSITY:
+      {
+        Density * density = &cmd.density;
+        read_geometry(&density->geos, pipe);
+        upload_points(osk, &density->geos);
+        density->bins = osCreateBuffer(osk, OS_STATIC_DRAW);
+        osBufferData(osk, density->bins, sizeof(uint32_t[1 + density->bins_x * density->bins_y]), NULL);
+        density->binned = (PlotView) { NAN, NAN, NAN, NAN };
+        cmds[num_cmds++] = cmd;
+        break;
+      }
       case PLOT_BITMAP:
-        //cmd.bitmap.tex = load_bitmap(cmd, pipe);
-        assert(0);
+        read_bitmap(&cmd.bitmap, pipe);
         cmds[num_cmds++] = cmd;
         break;
+      case PLOT_IMAGE_RANGE:
+        // only the coloring changes, the textures stay as they are
+        for(size_t i = num_cmds; i-- > 0;) {
+          if(cmds[i].type == PLOT_BITMAP && cmds[i].bitmap.num_channels == 1) {
+            cmds[i].bitmap.vmin = cmd.range.vmin;
+            cmds[i].bitmap.vmax = cmd.range.vmax;
+            cmds[i].bitmap.colormap = cmd.range.colormap;
+            retained = false;
+            break;
+          }
+        }
+        break;
       default:
         cmds[num_cmds++] = cmd;
         break;
     }
 
+    // anything else drawn ends the run of strips
+    bool draws = cmd.type == PLOT_POINT || cmd.type == PLOT_POINTS || cmd.type == PLOT_LINE ||
+                 cmd.type == PLOT_LINES || cmd.type == PLOT_DENSITY || cmd.type == PLOT_BITMAP;
+    if(draws && !(cmd.type == PLOT_LINES && cmd.geos.strip >= 0))
+      strip_run_open = false;
   }
 }
 
-static float min(float a, float b) {
-  return a < b ? a : b;
-}
+enum { POINT_CHUNK = 4096, LINE_CHUNK = 65536 };
 
-static float max(float a, float b) {
-  return a >= b ? a : b;
+// a point's square, half a point size (sx, sy) to each side
+static inline void point_quad(OldskoolVert2 * v, float x, float y, float sx, float sy) {
+  v[0] = (OldskoolVert2) { x - sx, y - sy };
+  v[1] = (OldskoolVert2) { x + sx, y - sy };
+  v[2] = (OldskoolVert2) { x + sx, y + sy };
+  v[3] = (OldskoolVert2) { x - sx, y + sy };
 }
 
-static void draw_cmds(VGWindow * win, OldskoolContext * osk) {
+// the view given with plot_view, or the padded bounds of everything
+// plotted. false when there's nothing to draw
+static bool scene_view(PlotView * view) {
+  if(fixed_view) {
+    *view = view_box;
+    return true;
+  }
   float minx = INFINITY, miny = INFINITY;
   float maxx = -INFINITY, maxy = -INFINITY;
 
@@ -482,12 +1339,16 @@ static void draw_cmds(VGWindow * win, OldskoolContext * osk) {
         break;
       case PLOT_POINTS:
       case PLOT_LINES:
-        for(int i = 0; i < cmd.geos.ct; i++) {
-          minx = min(minx, cmd.geos.xs[i]);
-          miny = min(miny, cmd.geos.ys[i]);
-          maxx = max(maxx, cmd.geos.xs[i]);
-          maxy = max(maxy, cmd.geos.ys[i]);
-        }
+        minx = min(minx, cmd.geos.minx);
+        miny = min(miny, cmd.geos.miny);
+        maxx = max(maxx, cmd.geos.maxx);
+        maxy = max(maxy, cmd.geos.maxy);
+        break;
+      case PLOT_DENSITY:
+        minx = min(minx, cmd.density.geos.minx);
+        miny = min(miny, cmd.density.geos.miny);
+        maxx = max(maxx, cmd.density.geos.maxx);
+        maxy = max(maxy, cmd.density.geos.maxy);
         break;
       case PLOT_LINE:
         minx = min(minx, cmd.line.x1);
@@ -517,7 +1378,7 @@ static void draw_cmds(VGWindow * win, OldskoolContext * osk) {
   }
   // no data to draw
   if(minx > maxy)
-    return;
+    return false;
   if(minx == maxx) {
     minx -= 1;
     maxx += 1;
@@ -535,66 +1396,430 @@ static void draw_cmds(VGWindow * win, OldskoolContext * osk) {
   miny -= spany * 0.05;
   maxy += spany * 0.05;
 
-  float aspect = win->swap_extent.width / (float) win->swap_extent.height;
+  *view = (PlotView) { minx, miny, maxx, maxy };
+  return true;
+}
 
-  float psizex = 4.0 / win->swap_extent.width;
-  float psizey = 4.0 / win->swap_extent.height;
+static double now_ms(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
 
-  float lsizex = 1.0 / win->swap_extent.width;
-  float lsizey = 1.0 / win->swap_extent.height;
+// how many points the preview pass draws at most, the whole scene is
+// thinned by the same stride so the preview keeps its proportions
+enum { PREVIEW_POINTS = 1 << 18 };
+
+static int preview_stride(void) {
+  size_t total = 0;
+  for(size_t i = 0; i < num_cmds; i++)
+    if(cmds[i].type == PLOT_POINTS || cmds[i].type == PLOT_LINES)
+      total += cmds[i].geos.ct;
+  return total / PREVIEW_POINTS + 1;
+}
+
+// the pixels covered by points of the current color since it was last
+// changed or something else was drawn. a pixel is covered when its byte is
+// cover_gen, so forgetting them all is just a new generation
+static uint8_t * covered = NULL;
+static int covered_w = 0, covered_h = 0;
+static uint8_t cover_gen = 1;
+
+static void uncover(void) {
+  if(++cover_gen == 0) {
+    memset(covered, 0, covered_w * covered_h);
+    cover_gen = 1;
+  }
+}
+
+static void cover_screen(int w, int h) {
+  if(w == covered_w && h == covered_h)
+    return;
+  free(covered);
+  covered = calloc(w * h, 1);
+  covered_w = w;
+  covered_h = h;
+  cover_gen = 1;
+}
+
+// moves a point to the nearest pixel corner so its quad covers whole
+// pixels, the same with dedupe on or off. with it on, false if it's then
+// off screen, or if all of its pixels already have its color so drawing it
+// wouldn't change anything
+static bool place_point(float * x, float * y) {
+  // quads are 4 pixels a side, see psizex
+  int px = rintf((*x + 1) * covered_w / 2) - 2;
+  int py = rintf((*y + 1) * covered_h / 2) - 2;
+  *x = (px + 2) * 2.0f / covered_w - 1;
+  *y = (py + 2) * 2.0f / covered_h - 1;
+  if(!dedupe)
+    return true;
+  if(px <= -4 || px >= covered_w || py <= -4 || py >= covered_h)
+    return false;
 
-  // the telltale matrix that the author has opengl brain damage
-  mat4 vulkan_squish = { {
+  uint8_t * row = covered + py * covered_w + px;
+  if(px >= 0 && px + 4 <= covered_w && py >= 0 && py + 4 <= covered_h) {
+    // all on screen, a row of the quad is one word
+    uint32_t gen4 = cover_gen * 0x01010101u;
+    bool hidden = true;
+    for(int j = 0; j < 4; j++) {
+      uint32_t w;
+      memcpy(&w, row + j * covered_w, 4);
+      hidden &= w == gen4;
+      memcpy(row + j * covered_w, &gen4, 4);
+    }
+    return !hidden;
+  }
+
+  bool hidden = true;
+  for(int j = 0; j < 4; j++) {
+    for(int i = 0; i < 4; i++) {
+      if(px + i < 0 || px + i >= covered_w || py + j < 0 || py + j >= covered_h)
+        continue;
+      hidden &= row[j * covered_w + i] == cover_gen;
+      row[j * covered_w + i] = cover_gen;
+    }
+  }
+  return !hidden;
+}
+
+// the telltale matrix that the author has opengl brain damage
+static mat4 vulkan_squish(void) {
+  mat4 squish = { {
     make_vec4(1, 0, 0, 0),
     make_vec4(0,-1, 0, 0),
     make_vec4(0, 0,.5,.5),
     make_vec4(0, 0, 0, 1),
   } };
-  osLoadMatrix(osk, vulkan_squish);
-  mat4 mat = mat4_ortho(minx, maxx, miny, maxy, 1, -1);
+  return squish;
+}
+
+// counts the density plots' points again for a view they weren't binned for
+static void bin_density(OldskoolContext * osk, VkCommandBuffer cmdbuf, PlotView view) {
+  mat4 mvp = mat4_mul(vulkan_squish(), mat4_ortho(view.minx, view.maxx, view.miny, view.maxy, 1, -1));
+  for(size_t i = 0; i < num_cmds; i++) {
+    if(cmds[i].type != PLOT_DENSITY)
+      continue;
+    Density * density = &cmds[i].density;
+    PlotView b = density->binned;
+    if(b.minx == view.minx && b.miny == view.miny && b.maxx == view.maxx && b.maxy == view.maxy)
+      continue;
+    if(!osBinPoints(osk, cmdbuf, mvp, density->bins, density->bins_x, density->bins_y, line_points, density->geos.first, density->geos.ct))
+      density->binned = view;
+  }
+
+  PlotView b = dense_binned;
+  if(num_dense_series == 0 || (dense_binned_ct == num_dense_series &&
+      b.minx == view.minx && b.miny == view.miny && b.maxx == view.maxx && b.maxy == view.maxy))
+    return;
+  if(!osBinLines(osk, cmdbuf, mvp, dense_bins, dense_lines.bins_x, dense_lines.bins_y, line_points, dense_series, num_dense_series)) {
+    dense_binned = view;
+    dense_binned_ct = num_dense_series;
+  }
+}
+
+// has the gpu pick out the short strips from first on that reach the
+// screen, for draw_cmds to draw together
+static void cull_strips(VGWindow * win, OldskoolContext * osk, VkCommandBuffer cmdbuf, PlotView view, int first) {
+  strips_culled = -1;
+  if(first >= num_strip_series || strip_draws_used > strip_draws_size)
+    return;
+  mat4 mvp = mat4_mul(vulkan_squish(), mat4_ortho(view.minx, view.maxx, view.miny, view.maxy, 1, -1));
+  // a couple of pixels for the width of the lines
+  float margin_x = 4.0 / win->swap_extent.width;
+  float margin_y = 4.0 / win->swap_extent.height;
+  if(!osCullStrips(osk, cmdbuf, mvp, margin_x, margin_y, strip_series, first, num_strip_series - first, strip_draws))
+    strips_culled = first;
+}
+
+// shuffles with literal masks, vec4_swizzle_4 only gets an immediate when
+// it's inlined and it isn't at -O0
+static float vec4_hmax(vec4 v) {
+  v = vec4_max(v, (vec4) { _mm_shuffle_ps(v.raw, v.raw, _MM_SHUFFLE(1, 0, 3, 2)) });
+  v = vec4_max(v, (vec4) { _mm_shuffle_ps(v.raw, v.raw, _MM_SHUFFLE(2, 3, 0, 1)) });
+  return vec4_getX(v);
+}
+
+static float vec4_hmin(vec4 v) {
+  v = vec4_min(v, (vec4) { _mm_shuffle_ps(v.raw, v.raw, _MM_SHUFFLE(1, 0, 3, 2)) });
+  v = vec4_min(v, (vec4) { _mm_shuffle_ps(v.raw, v.raw, _MM_SHUFFLE(2, 3, 0, 1)) });
+  return vec4_getX(v);
+}
 
-  vec4 p0 = make_vec4(-psizex, -psizey, 0, 0);
-  vec4 p1 = make_vec4(+psizex, -psizey, 0, 0);
-  vec4 p2 = make_vec4(+psizex, +psizey, 0, 0);
-  vec4 p3 = make_vec4(-psizex, +psizey, 0, 0);
+// liang-barsky clipping of a segment to box, all four edges at once. false
+// when none of the segment is inside
+static bool clip_segment(PlotView box, Line * line) {
+  float dx = line->x2 - line->x1;
+  float dy = line->y2 - line->y1;
+  // parallel to two of the edges, the lanes for those can't tell in from out
+  if(dx == 0 && (line->x1 < box.minx || line->x1 > box.maxx))
+    return false;
+  if(dy == 0 && (line->y1 < box.miny || line->y1 > box.maxy))
+    return false;
+
+  vec4 p = make_vec4(-dx, dx, -dy, dy);
+  vec4 q = make_vec4(line->x1 - box.minx, box.maxx - line->x1, line->y1 - box.miny, box.maxy - line->y1);
+  vec4 t = vec4_div(q, p);
+  vec4 zero = make_vec4(0);
+  // edges the segment heads in through bound it from below, the rest from above
+  float t0 = max(0, vec4_hmax(vec4_blendv(make_vec4(-INFINITY), t, vec4_lessThan(p, zero))));
+  float t1 = min(1, vec4_hmin(vec4_blendv(make_vec4(INFINITY), t, vec4_greaterThan(p, zero))));
+  if(t0 > t1)
+    return false;
 
-  vec3 color = make_vec3(0);
-  osBegin(osk, OS_TRIANGLES);
+  float x = line->x1, y = line->y1;
+  *line = (Line) { x + t0*dx, y + t0*dy, x + t1*dx, y + t1*dy };
+  return true;
+}
+
+// first of xs, which only go up, that's past x (or at it with at)
+static int search_x(const float * xs, int ct, float x, bool at) {
+  int lo = 0, hi = ct;
+  while(lo < hi) {
+    int mid = lo + (hi - lo) / 2;
+    if(xs[mid] < x || (!at && xs[mid] == x))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+static int tile_index(float t, int n) {
+  if(!(t > 0))
+    return 0;
+  return t < n ? (int)t : n - 1;
+}
+
+// the level of bit with about a texel per pixel in view, the finer way, and
+// the tiles of it in view as x0 y0 x1 y1, inclusive. false if it's out of
+// view. the first texel goes at the bitmap's lower left whichever way x1 y1
+// x2 y2 run
+static bool bitmap_tiles(Bitmap * bit, PlotView view, VkExtent2D extent, int * l, int t[4]) {
+  float minx = min(bit->x1, bit->x2), maxx = max(bit->x1, bit->x2);
+  float miny = min(bit->y1, bit->y2), maxy = max(bit->y1, bit->y2);
+  if(bit->num_levels == 0 || !(maxx > minx && maxy > miny))
+    return false;
+  if(maxx < view.minx || minx > view.maxx || maxy < view.miny || miny > view.maxy)
+    return false;
+
+  float px = (maxx - minx) / (view.maxx - view.minx) * extent.width;
+  float py = (maxy - miny) / (view.maxy - view.miny) * extent.height;
+  float per_pixel = min(bit->w / px, bit->h / py);
+  int i = 0;
+  while(i + 1 < bit->num_levels && per_pixel >= 2) {
+    per_pixel /= 2;
+    i++;
+  }
+  *l = i;
+
+  BitmapLevel * level = &bit->levels[i];
+  if(!level->tiles) {
+    level->tiles_x = (level->w + bitmap_tile - 1) / bitmap_tile;
+    level->tiles_y = (level->h + bitmap_tile - 1) / bitmap_tile;
+    level->tiles = calloc(level->tiles_x * level->tiles_y, sizeof(OldskoolTexture*));
+    level->used = calloc(level->tiles_x * level->tiles_y, sizeof(unsigned));
+  }
+  float tx = level->w / (maxx - minx) / bitmap_tile;
+  float ty = level->h / (maxy - miny) / bitmap_tile;
+  t[0] = tile_index((view.minx - minx) * tx, level->tiles_x);
+  t[1] = tile_index((view.miny - miny) * ty, level->tiles_y);
+  t[2] = tile_index((view.maxx - minx) * tx, level->tiles_x);
+  t[3] = tile_index((view.maxy - miny) * ty, level->tiles_y);
+  return true;
+}
+
+// makes textures of the bitmap tiles coming into view, before the frame's
+// uploads, and lets go of the ones out of view if there are too many. true
+// when some in view are left for the next frames
+static bool load_tiles(OldskoolContext * osk, PlotView view, VkExtent2D extent) {
+  tile_gen++;
+  bool missing = false;
+  int loads = 0;
+  size_t budget = LEVEL_TEXELS;
   for(size_t i = 0; i < num_cmds; i++) {
-    PlotCommand cmd = cmds[i];
+    if(cmds[i].type != PLOT_BITMAP)
+      continue;
+    Bitmap * bit = &cmds[i].bitmap;
+    int l, t[4];
+    if(!bitmap_tiles(bit, view, extent, &l, t))
+      continue;
+    if(!build_level(bit, l, &budget)) {
+      missing = true;
+      continue;
+    }
+    BitmapLevel * level = &bit->levels[l];
+    for(int ty = t[1]; ty <= t[3]; ty++) {
+      for(int tx = t[0]; tx <= t[2]; tx++) {
+        int j = ty * level->tiles_x + tx;
+        level->used[j] = tile_gen;
+        if(level->tiles[j])
+          continue;
+        if(loads == TILE_LOADS) {
+          missing = true;
+          continue;
+        }
+        loads++;
+        int r[4];
+        tile_texels(level, tx, ty, r);
+        int w = r[2] - r[0], h = r[3] - r[1];
+        int format = bitmap_format(bit);
+        OldskoolTexture * tex = osCreateTexture(osk, w, h, format, bit->nearest);
+        if(!tex)
+          continue;
+        const unsigned char * bits = level->bits + bitmap_texel(bit) * ((size_t)r[1] * level->w + r[0]);
+        if(osTexImage(osk, tex, level->w, bits)) {
+          osDestroyTexture(osk, tex);
+          continue;
+        }
+        level->tiles[j] = tex;
+        tile_bytes += tile_size(bit, level, tx, ty);
+      }
+    }
+  }
+
+  if(tile_bytes <= TILE_BUDGET)
+    return missing;
+  for(size_t i = 0; i < num_cmds; i++) {
+    if(cmds[i].type != PLOT_BITMAP)
+      continue;
+    Bitmap * bit = &cmds[i].bitmap;
+    for(int l = 0; l < bit->num_levels; l++) {
+      BitmapLevel * level = &bit->levels[l];
+      if(!level->tiles)
+        continue;
+      for(int ty = 0; ty < level->tiles_y; ty++)
+        for(int tx = 0; tx < level->tiles_x; tx++)
+          if(level->used[ty * level->tiles_x + tx] != tile_gen)
+            drop_tile(osk, bit, level, tx, ty);
+    }
+  }
+  return missing;
+}
+
+// draws the commands from where progress got to until they're all drawn or
+// deadline passes, progress is left where it stopped. at least one chunk is
+// drawn per call so a scene always gets finished
+static void draw_cmds(VGWindow * win, OldskoolContext * osk, PlotView view, PlotProgress * progress, double deadline) {
+  float aspect = win->swap_extent.width / (float) win->swap_extent.height;
+
+  // points are 4 pixel squares on pixel corners, see place_point, so their
+  // edges are sharp without msaa
+  float psizex = 4.0 / win->swap_extent.width;
+  float psizey = 4.0 / win->swap_extent.height;
+
+  float lsizex = 1.0 / win->swap_extent.width;
+  float lsizey = 1.0 / win->swap_extent.height;
+  osLineWidth(osk, 1);
+
+  osLoadMatrix(osk, vulkan_squish());
+  mat4 mat = mat4_ortho(view.minx, view.maxx, view.miny, view.maxy, 1, -1);
+
+  // the plot is flat, only the 2d part of the matrix matters for points
+  float mxx = vec4_getX(mat.cols[0]), mxy = vec4_getX(mat.cols[1]), mx = vec4_getX(mat.cols[3]);
+  float myx = vec4_getY(mat.cols[0]), myy = vec4_getY(mat.cols[1]), my = vec4_getY(mat.cols[3]);
+
+  // all the geometry is solid colored, so the color rides along per draw
+  osVertexFormat(osk, OS_V2F);
+
+  // anything outside this box can't reach the window
+  float margin_x = psizex * (view.maxx - view.minx) / 2;
+  float margin_y = psizey * (view.maxy - view.miny) / 2;
+  PlotView cull = { view.minx - margin_x, view.miny - margin_y, view.maxx + margin_x, view.maxy + margin_y };
+
+  cover_screen(win->swap_extent.width, win->swap_extent.height);
+
+  int stride = progress->preview ? progress->stride : 1;
+  bool drew = false;
+  osBegin(osk, OS_QUADS);
+  for(; progress->cmd < num_cmds; progress->cmd++, progress->point = 0) {
+    if(drew && now_ms() > deadline)
+      goto end;
+    PlotCommand cmd = cmds[progress->cmd];
     switch(cmd.type) {
       case PLOT_COLOR:
-        color = cmd.color;
+        if(!vec3_allEqual(cmd.color, progress->color))
+          uncover();
+        progress->color = cmd.color;
         break;
       case PLOT_POINT:
-        osColor3(osk, color);
-        vec4 pt = mat4_mul_vec4(mat, make_vec4(cmd.point.x, cmd.point.y, 0, 1));
-          osVertex4(osk, vec4_add(p0, pt));
-          osVertex4(osk, vec4_add(p1, pt));
-          osVertex4(osk, vec4_add(p2, pt));
-
-          osVertex4(osk, vec4_add(p0, pt));
-          osVertex4(osk, vec4_add(p2, pt));
-          osVertex4(osk, vec4_add(p3, pt));
+      {
+        float x = cmd.point.x, y = cmd.point.y;
+        if(x < cull.minx || x > cull.maxx || y < cull.miny || y > cull.maxy)
+          continue;
+        x = mxx*cmd.point.x + mxy*cmd.point.y + mx;
+        y = myx*cmd.point.x + myy*cmd.point.y + my;
+        if(!place_point(&x, &y))
+          continue;
+        osColor3(osk, progress->color);
+        point_quad(osReserve(osk, 4), x, y, psizex, psizey);
+        drew = true;
         break;
+      }
       case PLOT_POINTS:
-        osColor3(osk, color);
-        for(int i = 0; i < cmd.geos.ct; i++) {
-          vec4 pt = mat4_mul_vec4(mat, make_vec4(cmd.geos.xs[i], cmd.geos.ys[i], 0, 1));
-          osVertex4(osk, vec4_add(p0, pt));
-          osVertex4(osk, vec4_add(p1, pt));
-          osVertex4(osk, vec4_add(p2, pt));
-
-          osVertex4(osk, vec4_add(p0, pt));
-          osVertex4(osk, vec4_add(p2, pt));
-          osVertex4(osk, vec4_add(p3, pt));
+      {
+        Geometry * geos = &cmd.geos;
+        if(geos->maxx < cull.minx || geos->minx > cull.maxx || geos->maxy < cull.miny || geos->miny > cull.maxy)
+          continue;
+        // only the rows and columns of grid cells in view get drawn
+        int x0 = 0, x1 = 0, y0 = 0, y1 = 0;
+        if(geos->cells) {
+          x0 = grid_cell(cull.minx, geos->minx, geos->maxx, geos->grid_w);
+          x1 = grid_cell(cull.maxx, geos->minx, geos->maxx, geos->grid_w);
+          y0 = grid_cell(cull.miny, geos->miny, geos->maxy, geos->grid_h);
+          y1 = grid_cell(cull.maxy, geos->miny, geos->maxy, geos->grid_h);
+        }
+        osColor3(osk, progress->color);
+        for(int row = y0; row <= y1; row++) {
+          int from = geos->cells ? geos->cells[row * geos->grid_w + x0] : 0;
+          int to = geos->cells ? geos->cells[row * geos->grid_w + x1 + 1] : geos->ct;
+          if(progress->point < from)
+            progress->point = from;
+          // reserve a chunk at a time, a whole plot may not fit in one block
+          while(progress->point < to) {
+            if(drew && now_ms() > deadline)
+              goto end;
+            int left = (to - progress->point + stride - 1) / stride;
+            int n = left < POINT_CHUNK ? left : POINT_CHUNK;
+            const float * xs = geos->xs + progress->point;
+            const float * ys = geos->ys + progress->point;
+            // points that wouldn't change a pixel are dropped before reserving
+            static OldskoolVert2 quads[4 * POINT_CHUNK];
+            int kept = 0;
+            for(int j = 0; j < n; j++) {
+              int k = j * stride;
+              float x = mxx*xs[k] + mxy*ys[k] + mx;
+              float y = myx*xs[k] + myy*ys[k] + my;
+              if(place_point(&x, &y))
+                point_quad(quads + 4 * kept++, x, y, psizex, psizey);
+            }
+            if(kept)
+              memcpy(osReserve(osk, 4 * kept), quads, sizeof(OldskoolVert2[4 * kept]));
+            progress->point += n * stride;
+            drew = true;
+          }
         }
         break;
+      }
       case PLOT_LINE:
       {
         Line line = cmd.line;
         if(line.x1 == line.x2 && line.y1 == line.y2)
           continue;
+        if(!clip_segment(cull, &line))
+          continue;
+        uncover();
+        if(win->msaa_samples <= 1) {
+          // without msaa only the line pipeline smooths the edges
+          osEnd(osk);
+          osColor3(osk, progress->color);
+          osPushMatrix(osk, mat);
+          osDrawLineStrip(osk, line_points, cmd.line.first, 2, 0, 1);
+          osPopMatrix(osk);
+          osBegin(osk, OS_QUADS);
+          drew = true;
+          break;
+        }
         vec4 s0 = mat4_mul_vec4(mat, make_vec4(line.x1, line.y1, 0, 1));
         vec4 s1 = mat4_mul_vec4(mat, make_vec4(line.x2, line.y2, 0, 1));
 
@@ -614,127 +1839,296 @@ static void draw_cmds(VGWindow * win, OldskoolContext * osk) {
         p2 = vec4_add(p2, s1);
         p3 = vec4_add(p3, s0);
 
-        osColor3(osk, color);
-          osVertex4(osk, p0);
-          osVertex4(osk, p1);
-          osVertex4(osk, p2);
-
-          osVertex4(osk, p0);
-          osVertex4(osk, p2);
-          osVertex4(osk, p3);
+        osColor3(osk, progress->color);
+        osVertex4(osk, p0);
+        osVertex4(osk, p1);
+        osVertex4(osk, p2);
+        osVertex4(osk, p3);
+        drew = true;
         break;
       }
-      case PLOT_LINES:
+      case PLOT_DENSITY:
       {
-        osColor3(osk, color);
-        vec4 last_p1;
-        vec4 last_p2;
-        for(int i = 1; i < cmd.geos.ct; i++) {
-          vec4 s0 = mat4_mul_vec4(mat, make_vec4(cmd.geos.xs[i-1], cmd.geos.ys[i-1], 0, 1));
-          vec4 s1 = mat4_mul_vec4(mat, make_vec4(cmd.geos.xs[i-0], cmd.geos.ys[i-0], 0, 1));
-
-          vec2 tangent = vec2_normalize(make_vec2(vec4_getX(s1) - vec4_getX(s0), (vec4_getY(s1) - vec4_getY(s0))/aspect));
-          vec2 normal = make_vec2(-vec2_getY(tangent), vec2_getX(tangent));
-
-          tangent = make_vec2(lsizex * vec2_getX(tangent), lsizey * vec2_getY(tangent));
-          normal = make_vec2(lsizex * vec2_getX(normal), lsizey * vec2_getY(normal));
-
-          vec4 p0 = make_vec4(vec2_scale(-1, normal), 0, 0); // s0
-          vec4 p1 = make_vec4(vec2_scale(-1, normal), 0, 0); // s1
-          vec4 p2 = make_vec4(vec2_scale(+1, normal), 0, 0); // s1
-          vec4 p3 = make_vec4(vec2_scale(+1, normal), 0, 0); // s0
-
-          p0 = vec4_add(p0, s0);
-          p1 = vec4_add(p1, s1);
-          p2 = vec4_add(p2, s1);
-          p3 = vec4_add(p3, s0);
-          if(i != 1) {
-            // draw connection geometry
-            osVertex4(osk, p0);
-            osVertex4(osk, last_p2);
-            osVertex4(osk, last_p1);
-
-            osVertex4(osk, p3);
-            osVertex4(osk, last_p2);
-            osVertex4(osk, last_p1);
+        Density * density = &cmd.density;
+        if(density->geos.maxx < cull.minx || density->geos.minx > cull.maxx || density->geos.maxy < cull.miny || density->geos.miny > cull.maxy)
+          continue;
+        // nothing to show until the points have been binned once
+        if(isnan(density->binned.minx))
+          continue;
+        int colormap = density->colormap & ~PLOT_LOG;
+        osEnd(osk);
+        osDrawDensity(osk, density->bins, density->bins_x, density->bins_y, colormap < OS_NUM_COLORMAPS ? colormap : OS_GRAYS, density->colormap & PLOT_LOG);
+        osBegin(osk, OS_QUADS);
+        uncover();
+        drew = true;
+        break;
+      }
+      case PLOT_LINES:
+        if(cmd.geos.strip >= 0 && cmd.geos.strip < strips_drawn)
+          continue;
+        if(cmd.geos.strip >= 0 && strips_culled >= 0 && cmd.geos.strip >= strips_culled) {
+          // the rest of this strip's run, drawn here in one go
+          StripRun run = strip_runs[cmd.geos.run];
+          int start = run.first > strips_culled ? run.first : strips_culled;
+          osEnd(osk);
+          osPushMatrix(osk, mat);
+          osDrawStrips(osk, line_points, strip_series, strip_draws, run.slot, run.first + run.count - start);
+          osPopMatrix(osk);
+          osBegin(osk, OS_QUADS);
+          uncover();
+          strips_drawn = run.first + run.count;
+          drew = true;
+          break;
+        }
+        if(cmd.geos.dense) {
+          // nothing to show until the strips have been binned once
+          if(progress->cmd != dense_cmd || dense_binned_ct == 0)
+            continue;
+          int colormap = dense_lines.colormap & ~PLOT_LOG;
+          osEnd(osk);
+          osDrawDensity(osk, dense_bins, dense_lines.bins_x, dense_lines.bins_y, colormap < OS_NUM_COLORMAPS ? colormap : OS_GRAYS, dense_lines.colormap & PLOT_LOG);
+          osBegin(osk, OS_QUADS);
+          uncover();
+          drew = true;
+          break;
+        }
+        osEnd(osk);
+        osColor3(osk, progress->color);
+        uncover();
+        // the full pass has to cover everything the preview drew, so a
+        // preview only has the strips that are cheap to draw whole
+        if(stride == 1 || cmd.geos.monotonic || cmd.geos.ct <= PREVIEW_POINTS) {
+          // line strips are expanded on the gpu straight from the uploaded
+          // points, or the pyramid level that looks the same at this zoom.
+          // the chunks are parts of the whole level so they join up
+          LineLod level = line_level(&cmd.geos, (view.maxx - view.minx) / win->swap_extent.width);
+          // strips with x only going up are cut down to the points in view
+          // and one either side
+          int i0 = 0, i1 = level.ct - 1;
+          if(cmd.geos.monotonic) {
+            i0 = search_x(level.xs, level.ct, cull.minx, true) - 1;
+            i1 = search_x(level.xs, level.ct, cull.maxx, false);
+            i0 = i0 < 0 ? 0 : i0;
+            i1 = i1 > level.ct - 1 ? level.ct - 1 : i1;
           }
-          osVertex4(osk, p0);
-          osVertex4(osk, p1);
-          osVertex4(osk, p2);
-
-          osVertex4(osk, p0);
-          osVertex4(osk, p2);
-          osVertex4(osk, p3);
-
-          last_p1 = p1;
-          last_p2 = p2;
+          if(progress->point < i0)
+            progress->point = i0;
+          osPushMatrix(osk, mat);
+          while(progress->point < i1) {
+            if(drew && now_ms() > deadline) {
+              osPopMatrix(osk);
+              osBegin(osk, OS_QUADS);
+              goto end;
+            }
+            int last = progress->point + LINE_CHUNK < i1 ? progress->point + LINE_CHUNK : i1;
+            osDrawLineStrip(osk, line_points, level.first, level.ct, progress->point, last - progress->point);
+            progress->point = last;
+            drew = true;
+          }
+          osPopMatrix(osk);
         }
-      }
-      /*
+        if(cmd.geos.strip >= 0)
+          strips_drawn = cmd.geos.strip + 1;
+        osBegin(osk, OS_QUADS);
+        break;
       case PLOT_BITMAP:
       {
-        Bitmap bit = cmd.bitmap;
-        float minx = min(bit.x1, bit.x2);
-        float maxx = max(bit.x1, bit.x2);
-        float miny = min(bit.y1, bit.y2);
-        float maxy = max(bit.y1, bit.y2);
-        vec2 p0 = make_vec2(minx, miny);
-        vec2 p1 = make_vec2(maxx, miny);
-        vec2 p2 = make_vec2(maxx, maxy);
-        vec2 p3 = make_vec2(minx, maxy);
-
-        vec2 t0 = make_vec2(0, 0);
-        vec2 t1 = make_vec2(1, 0);
-        vec2 t2 = make_vec2(1, 1);
-        vec2 t3 = make_vec2(0, 1);
-
-        //vi3d_end();
-        vi3d_texture2d(cmd.bitmap.tex, 0);
-        vi3d_begin(VI3D_TRIANGLES);
-          vi3d_color3f(1, 1, 1);
-          vi3d_texcoord2(t0);
-          vi3d_vertex2(p0);
-          vi3d_texcoord2(t1);
-          vi3d_vertex2(p1);
-          vi3d_texcoord2(t2);
-          vi3d_vertex2(p2);
-
-          vi3d_texcoord2(t2);
-          vi3d_vertex2(p2);
-          vi3d_texcoord2(t3);
-          vi3d_vertex2(p3);
-          vi3d_texcoord2(t0);
-          vi3d_vertex2(p0);
-        vi3d_end();
-        vi3d_texture2d(0, 0);
+        Bitmap * bit = &cmds[progress->cmd].bitmap;
+        int l, t[4];
+        if(!bitmap_tiles(bit, view, win->swap_extent, &l, t))
+          continue;
+        BitmapLevel * level = &bit->levels[l];
+        float minx = min(bit->x1, bit->x2);
+        float miny = min(bit->y1, bit->y2);
+        float sx = (max(bit->x1, bit->x2) - minx) / level->w;
+        float sy = (max(bit->y1, bit->y2) - miny) / level->h;
+        int colormap = bit->colormap & ~PLOT_LOG;
+        colormap = colormap >= 0 && colormap < OS_NUM_COLORMAPS ? colormap : OS_GRAYS;
+        osEnd(osk);
+        osPushMatrix(osk, mat);
+        for(int ty = t[1]; ty <= t[3]; ty++) {
+          for(int tx = t[0]; tx <= t[2]; tx++) {
+            OldskoolTexture * tex = level->tiles[ty * level->tiles_x + tx];
+            if(!tex)
+              continue;
+            // just the tile's own texels, the border is there for filtering
+            int r[4];
+            tile_texels(level, tx, ty, r);
+            int x0 = tx * bitmap_tile, y0 = ty * bitmap_tile;
+            int x1 = x0 + bitmap_tile < level->w ? x0 + bitmap_tile : level->w;
+            int y1 = y0 + bitmap_tile < level->h ? y0 + bitmap_tile : level->h;
+            float tw = r[2] - r[0], th = r[3] - r[1];
+            vec4 rect = make_vec4(minx + x0 * sx, miny + y0 * sy, minx + x1 * sx, miny + y1 * sy);
+            vec4 uv = make_vec4((x0 - r[0]) / tw, (y0 - r[1]) / th, (x1 - r[0]) / tw, (y1 - r[1]) / th);
+            if(bit->num_channels == 1)
+              osDrawScalarTexture(osk, tex, rect, uv, colormap, bit->colormap & PLOT_LOG, bit->vmin, bit->vmax);
+            else
+              osDrawTexture(osk, tex, rect, uv);
+          }
+        }
+        osPopMatrix(osk);
+        osBegin(osk, OS_QUADS);
+        uncover();
+        drew = true;
+        break;
       }
-      */
       default:
         break;
     }
   }
+end:
   osEnd(osk);
 }
 
+// copies the frame image, resolved first if it's multisampled, into a
+// buffer the cpu can read once the frame is done. resolved is the image it
+// went through, let go of along with the buffer
+static VGBuffer record_read(VGWindow * wind, VkCommandBuffer cmdbuf, VGImage * resolved) {
+  VkExtent2D extent = wind->swap_extent;
+  VGBuffer buf = VG_CreateBufferImpl(wind, 4 * (VkDeviceSize)extent.width * extent.height, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  if(buf.buf == VK_NULL_HANDLE)
+    return buf;
+
+  VkImageSubresourceLayers subresource = {
+    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+    .layerCount = 1,
+  };
+  VkImage src = wind->primary_frameimage.img;
+  if(wind->msaa_samples > 1) {
+    *resolved = VG_CreateImageImpl(wind, extent.width, extent.height, 1, VK_SAMPLE_COUNT_1_BIT, wind->swapformat.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    if(resolved->view == VK_NULL_HANDLE) {
+      VG_DestroyBuffer(wind, buf);
+      return (VGBuffer) { VK_NULL_HANDLE };
+    }
+    VkImageMemoryBarrier barrier = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+      .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = resolved->img,
+      .subresourceRange = {
+        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .levelCount = 1,
+        .layerCount = 1,
+      },
+    };
+    vkCmdPipelineBarrier(cmdbuf,
+      VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0,
+      0, NULL,
+      0, NULL,
+      1, &barrier
+    );
+    VkImageResolve region = {
+      .srcSubresource = subresource,
+      .dstSubresource = subresource,
+      .extent = { extent.width, extent.height, 1 },
+    };
+    vkCmdResolveImage(cmdbuf, src, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, resolved->img, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    vkCmdPipelineBarrier(cmdbuf,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0,
+      0, NULL,
+      0, NULL,
+      1, &barrier
+    );
+    src = resolved->img;
+  }
+
+  VkBufferImageCopy region = {
+    .imageSubresource = subresource,
+    .imageExtent = { extent.width, extent.height, 1 },
+  };
+  vkCmdCopyImageToBuffer(cmdbuf, src, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buf.buf, 1, &region);
+  VkMemoryBarrier barrier = {
+    .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+    .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+    .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+  };
+  vkCmdPipelineBarrier(cmdbuf,
+    VK_PIPELINE_STAGE_TRANSFER_BIT,
+    VK_PIPELINE_STAGE_HOST_BIT,
+    0,
+    1, &barrier,
+    0, NULL,
+    0, NULL
+  );
+  return buf;
+}
+
+// hands the pixels record_read copied at extent to the parent, as rgba.
+// they only fit while the window is the size it was made
+static void finish_read(VGWindow * wind, VGBuffer buf, VkExtent2D extent) {
+  bool ok = buf.buf != VK_NULL_HANDLE && extent.width == child_w && extent.height == child_h;
+  if(ok) {
+    memcpy(child_stats->pixels, buf.map, 4 * (size_t)child_w * child_h);
+    if(wind->swapformat.format == VK_FORMAT_B8G8R8A8_SRGB) {
+      for(size_t i = 0; i < (size_t)child_w * child_h; i++) {
+        unsigned char b = child_stats->pixels[4 * i];
+        child_stats->pixels[4 * i] = child_stats->pixels[4 * i + 2];
+        child_stats->pixels[4 * i + 2] = b;
+      }
+    }
+  }
+  child_stats->read_ok = ok;
+  __sync_synchronize();
+  child_stats->reads++;
+}
+
 static void child_loop(VGWindow * wind, int pipe) {
   WindStatus status = {0};
-  bool frame_parity = false;
   
-  VkCommandBuffer command_buf[2];
+  VkCommandBuffer command_buf[VG_MAX_FRAMES];
   {
     VkCommandBufferAllocateInfo createInfo = {
       .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
       .commandPool = wind->commandpool,
       .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
-      .commandBufferCount = 2,
+      .commandBufferCount = VG_MAX_FRAMES,
     };
     if(vkAllocateCommandBuffers(wind->device, &createInfo, command_buf) != VK_SUCCESS) {
       fprintf(stderr, "failed to create command pool\n");
       exit(1);
     }
   }
+  // a timestamp at the start and end of each frame's commands
+  VkQueryPool timestamps = VK_NULL_HANDLE;
+  bool timed[VG_MAX_FRAMES] = { false };
+  float timestamp_period;
+  {
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(wind->physical_device, &props);
+    timestamp_period = props.limits.timestampPeriod;
+    if(props.limits.maxImageDimension2D < BITMAP_TILE)
+      bitmap_tile = props.limits.maxImageDimension2D - 2;
+    VkQueryPoolCreateInfo createInfo = {
+      .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+      .queryType = VK_QUERY_TYPE_TIMESTAMP,
+      .queryCount = 2 * VG_MAX_FRAMES,
+    };
+    if(props.limits.timestampComputeAndGraphics &&
+       vkCreateQueryPool(wind->device, &createInfo, NULL, &timestamps) != VK_SUCCESS)
+      timestamps = VK_NULL_HANDLE;
+  }
+
   OldskoolContext * osk = osCreate(wind);
-  
+  if(!osTexFormatFilters(osk, OS_R32F))
+    scalar_format = OS_R16F;
+  line_points = osCreateBuffer(osk, OS_STATIC_DRAW);
+  dense_bins = osCreateBuffer(osk, OS_STATIC_DRAW);
+  dense_series = osCreateBuffer(osk, OS_STATIC_DRAW);
+  strip_series = osCreateBuffer(osk, OS_STATIC_DRAW);
+  strip_draws = osCreateBuffer(osk, OS_STATIC_DRAW);
+
+  frame_due = now_ms();
   while(plot_running) {
     poll_events(wind, &status);
     if(status.program_exit) {
@@ -742,10 +2136,32 @@ static void child_loop(VGWindow * wind, int pipe) {
       break;
     }
 
-    read_cmds(wind, &status, pipe);
+    // everything queued is drawn before looking for new commands, so they
+    // go straight into the next frame
+    if(low_latency)
+      VG_WaitFrame(wind, wind->frame_count);
 
-    if(status.minimized)
+    read_cmds(wind, osk, &status, pipe);
+
+    if(status.minimized) {
+      wait_for_work(pipe, 10);
       continue;
+    }
+
+    if(present_mode >= 0) {
+      VkPresentModeKHR modes[] = {
+        [PLOT_VSYNC] = VK_PRESENT_MODE_FIFO_KHR,
+        [PLOT_MAILBOX] = VK_PRESENT_MODE_MAILBOX_KHR,
+        [PLOT_IMMEDIATE] = VK_PRESENT_MODE_IMMEDIATE_KHR,
+      };
+      if(VG_SetPresentMode(wind, modes[present_mode])) {
+        fprintf(stderr, "failed to change present mode\n");
+        exit(1);
+      }
+      present_mode = -1;
+      status.needs_redraw = true;
+      retained = false;
+    }
 
     if(!wind->swapchain_created)
     {
@@ -754,22 +2170,70 @@ static void child_loop(VGWindow * wind, int pipe) {
       bool valid_window = w != 0 && h != 0;
       if(!valid_window) {
         VG_RecreateSwapchain(wind);
+        retained = false;
       }
       if(!wind->swapchain_created) {
         continue;
       }
     }
 
-    vkWaitForFences(wind->device, 1, &wind->frame_fence[frame_parity], VK_TRUE, UINT64_MAX);
+    // once the uploads land whatever was drawn without them starts over
+    if(partial && !osUploadsPending(osk)) {
+      partial = false;
+      retained = false;
+      status.needs_redraw = true;
+    }
+
+    // the last presented image is still up, nothing to do until the
+    // commands or the window change or there's drawing left over
+    bool drawing = retained && (progress.preview || progress.cmd < num_cmds);
+    if(!frame_dirty && !drawing && !status.needs_redraw) {
+      double now = now_ms();
+      if(now >= frame_due) {
+        double interval = refresh_ms(wind);
+        unsigned long due = (now - frame_due) / interval + 1;
+        child_stats->skipped_frames += due;
+        frame_due += due * interval;
+      }
+      wait_for_work(pipe, 10);
+      continue;
+    }
+
+    if(max_fps > 0) {
+      double wait = last_frame + 1000 / max_fps - now_ms();
+      if(wait > 0) {
+        wait_for_work(pipe, wait < 10 ? (int)wait + 1 : 10);
+        continue;
+      }
+    }
+    last_frame = now_ms();
+    frame_due = last_frame + refresh_ms(wind);
+    status.needs_redraw = false;
+
+    uint32_t slot = VG_NextFrame(wind);
+    if(timed[slot]) {
+      uint64_t t[2];
+      if(vkGetQueryPoolResults(wind->device, timestamps, 2 * slot, 2, sizeof t, t, sizeof *t, VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+        child_stats->gpu_ms = (t[1] - t[0]) * timestamp_period / 1e6;
+      timed[slot] = false;
+    }
+    child_stats->attachment_bytes = wind->primary_frameimage.size;
 
     uint32_t image_index;
     {
-      VkResult ret = vkAcquireNextImageKHR(wind->device, wind->swapchain, UINT64_MAX, wind->image_available[frame_parity], VK_NULL_HANDLE, &image_index);
-      if(ret == VK_ERROR_OUT_OF_DATE_KHR) {
+      // don't hang on a window the compositor isn't taking frames from,
+      // the pipe and events still need looking after
+      VkResult ret = vkAcquireNextImageKHR(wind->device, wind->swapchain, ACQUIRE_TIMEOUT, wind->image_available[slot], VK_NULL_HANDLE, &image_index);
+      if(ret == VK_TIMEOUT || ret == VK_NOT_READY) {
+        status.needs_redraw = true;
+        continue;
+      } else if(ret == VK_ERROR_OUT_OF_DATE_KHR) {
         if(VG_RecreateSwapchain(wind)) {
           fprintf(stderr, "failed to resize window\n");
           exit(1);
         }
+        status.needs_redraw = true;
+        retained = false;
         continue;
 
       } else if(ret != VK_SUCCESS && ret != VK_SUBOPTIMAL_KHR) {
@@ -778,22 +2242,55 @@ static void child_loop(VGWindow * wind, int pipe) {
       }
     }
 
-    vkResetFences(wind->device, 1, &wind->frame_fence[frame_parity]);
-
+    // waiting for the image can take a while, in low latency mode whatever
+    // came in meanwhile still makes it into this frame
+    if(low_latency)
+      read_cmds(wind, osk, &status, pipe);
+
+    PlotView view;
+    bool has_view = scene_view(&view);
+    // carry on drawing into the retained image if it was drawn with the same
+    // view, otherwise everything is drawn again from scratch
+    bool incremental = retained && has_view && (accumulate || !frame_dirty) &&
+      dense_drawn == num_dense_series &&
+      view.minx == drawn_view.minx && view.miny == drawn_view.miny &&
+      view.maxx == drawn_view.maxx && view.maxy == drawn_view.maxy;
+    frame_dirty = false;
+
+    bool reading = false;
+    VGBuffer readback = { VK_NULL_HANDLE };
+    VGImage resolved = { VK_NULL_HANDLE };
+    VkExtent2D read_extent = wind->swap_extent;
     {
       VkCommandBufferBeginInfo beginfo = {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
         .flags = 0,
         .pInheritanceInfo = NULL,
       };
-      if(vkBeginCommandBuffer(command_buf[frame_parity], &beginfo) != VK_SUCCESS) {
+      if(vkBeginCommandBuffer(command_buf[slot], &beginfo) != VK_SUCCESS) {
         fprintf(stderr, "failed to begin command recording\n");
         exit(1);
       }
 
+      if(timestamps != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(command_buf[slot], timestamps, 2 * slot, 2);
+        vkCmdWriteTimestamp(command_buf[slot], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, timestamps, 2 * slot);
+      }
+
+      bool tiles_left = has_view && load_tiles(osk, view, wind->swap_extent);
+      osUploadBuffers(osk, command_buf[slot]);
+      partial = partial || tiles_left || osUploadsPending(osk);
+      if(has_view) {
+        bin_density(osk, command_buf[slot], view);
+        cull_strips(wind, osk, command_buf[slot], view, incremental ? strips_drawn : 0);
+      }
+
+      // the last frame left the image ready to resolve, keep its contents
+      // when drawing on top of it
       VkImageMemoryBarrier image_barrier = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        .oldLayout = incremental ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
         .newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
         .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
         .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
@@ -805,7 +2302,7 @@ static void child_loop(VGWindow * wind, int pipe) {
         },
       };
 
-      vkCmdPipelineBarrier(command_buf[frame_parity],
+      vkCmdPipelineBarrier(command_buf[slot],
         VK_PIPELINE_STAGE_TRANSFER_BIT,
         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
         0,
@@ -823,16 +2320,39 @@ static void child_loop(VGWindow * wind, int pipe) {
         .clearValueCount = 0,
         .pClearValues = NULL,
       };
-      vkCmdBeginRenderPass(command_buf[frame_parity], &rpinfo, VK_SUBPASS_CONTENTS_INLINE);
+      vkCmdBeginRenderPass(command_buf[slot], &rpinfo, VK_SUBPASS_CONTENTS_INLINE);
 
-      osReset(osk);
-      osClearColor(osk, make_vec4(1));
+      osReset(osk, slot);
 
-      draw_cmds(wind, osk);
+      if(!incremental) {
+        osClearColor(osk, make_vec4(1));
+        int stride = preview_stride();
+        progress = (PlotProgress) {
+          .preview = stride > 1,
+          .stride = stride,
+          .color = make_vec3(0),
+        };
+        drawn_view = view;
+        dense_drawn = num_dense_series;
+        strips_drawn = 0;
+        retained = has_view;
+        uncover();
+      }
+      if(retained) {
+        draw_cmds(wind, osk, view, &progress, now_ms() + frame_budget);
+        // the preview is done, the full pass draws over it from the start
+        if(progress.preview && progress.cmd == num_cmds) {
+          progress = (PlotProgress) { .color = make_vec3(0) };
+          strips_drawn = 0;
+          uncover();
+        }
+      }
+      // pixels are only read off a frame with everything on it
+      reading = read_wanted && !partial && (!retained || (!progress.preview && progress.cmd == num_cmds));
 
-      osSubmit(osk, command_buf[frame_parity], frame_parity);
+      osSubmit(osk, command_buf[slot], slot);
 
-      vkCmdEndRenderPass(command_buf[frame_parity]);
+      vkCmdEndRenderPass(command_buf[slot]);
 
       {
         VkImageMemoryBarrier image_barriers[] = {
@@ -864,7 +2384,7 @@ static void child_loop(VGWindow * wind, int pipe) {
           },
         };
 
-        vkCmdPipelineBarrier(command_buf[frame_parity],
+        vkCmdPipelineBarrier(command_buf[slot],
           VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
           VK_PIPELINE_STAGE_TRANSFER_BIT,
           0,
@@ -873,31 +2393,44 @@ static void child_loop(VGWindow * wind, int pipe) {
           2, image_barriers
         );
 
-        VkImageResolve resolve_region = {
-          .srcSubresource = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .layerCount = 1,
-          },
-          .srcOffset = { 0, 0, 0 },
-          .dstSubresource = {
-            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
-            .layerCount = 1,
-          },
-          .dstOffset = { 0, 0, 0 },
-          .extent = { wind->swap_extent.width, wind->swap_extent.height, 1 },
+        VkImageSubresourceLayers subresource = {
+          .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+          .layerCount = 1,
         };
-
-        vkCmdResolveImage(command_buf[frame_parity],
-          wind->primary_frameimage.img,
-          VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-          wind->swapimages[image_index],
-          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-          1,
-          &resolve_region);
+        VkExtent3D extent = { wind->swap_extent.width, wind->swap_extent.height, 1 };
+
+        // nothing to resolve without msaa, it's a plain copy
+        if(wind->msaa_samples > 1) {
+          VkImageResolve resolve_region = {
+            .srcSubresource = subresource,
+            .dstSubresource = subresource,
+            .extent = extent,
+          };
+          vkCmdResolveImage(command_buf[slot],
+            wind->primary_frameimage.img,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            wind->swapimages[image_index],
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1,
+            &resolve_region);
+        } else {
+          VkImageCopy copy_region = {
+            .srcSubresource = subresource,
+            .dstSubresource = subresource,
+            .extent = extent,
+          };
+          vkCmdCopyImage(command_buf[slot],
+            wind->primary_frameimage.img,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            wind->swapimages[image_index],
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            1,
+            &copy_region);
+        }
 
         image_barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
         image_barriers[0].newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-        vkCmdPipelineBarrier(command_buf[frame_parity],
+        vkCmdPipelineBarrier(command_buf[slot],
           VK_PIPELINE_STAGE_TRANSFER_BIT,
           VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
           0,
@@ -905,31 +2438,23 @@ static void child_loop(VGWindow * wind, int pipe) {
           0, NULL,
           1, image_barriers
         );
+
+        if(reading)
+          readback = record_read(wind, command_buf[slot], &resolved);
       }
 
-      if(vkEndCommandBuffer(command_buf[frame_parity]) != VK_SUCCESS) {
+      if(timestamps != VK_NULL_HANDLE) {
+        vkCmdWriteTimestamp(command_buf[slot], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, timestamps, 2 * slot + 1);
+        timed[slot] = true;
+      }
+
+      if(vkEndCommandBuffer(command_buf[slot]) != VK_SUCCESS) {
         fprintf(stderr, "failed to end command recording\n");
         exit(1);
       }
     }
 
-    VkSemaphore waitSemaphores[] = { wind->image_available[frame_parity] };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_TRANSFER_BIT };
-    VkSemaphore signalSemaphores[] = { wind->render_finished[frame_parity] };
-    VkSubmitInfo submitInfo = {
-      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-      .waitSemaphoreCount = sizeof waitSemaphores / sizeof *waitSemaphores,
-      .pWaitSemaphores = waitSemaphores,
-      .pWaitDstStageMask = waitStages,
-
-      .commandBufferCount = 1,
-      .pCommandBuffers = &command_buf[frame_parity],
-
-      .signalSemaphoreCount = sizeof signalSemaphores / sizeof *signalSemaphores,
-      .pSignalSemaphores = signalSemaphores,
-    };
-
-    if(vkQueueSubmit(wind->graphics_queue, 1, &submitInfo, wind->frame_fence[frame_parity]) != VK_SUCCESS) {
+    if(VG_SubmitFrame(wind, slot, command_buf[slot], VK_PIPELINE_STAGE_TRANSFER_BIT)) {
       fprintf(stderr, "failed to submit command buffers\n");
       exit(1);
     }
@@ -937,7 +2462,7 @@ static void child_loop(VGWindow * wind, int pipe) {
     VkPresentInfoKHR presentInfo = {
       .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
       .waitSemaphoreCount = 1,
-      .pWaitSemaphores = signalSemaphores,
+      .pWaitSemaphores = &wind->render_finished[slot],
 
       .swapchainCount = 1,
       .pSwapchains = &wind->swapchain,
@@ -950,20 +2475,39 @@ static void child_loop(VGWindow * wind, int pipe) {
       if(status.needs_resize || ret == VK_ERROR_OUT_OF_DATE_KHR || ret == VK_SUBOPTIMAL_KHR) {
         VG_RecreateSwapchain(wind);
         status.needs_resize = false;
+        status.needs_redraw = true;
+        retained = false;
       } else if(ret != VK_SUCCESS) {
         fprintf(stderr, "failed to present frame\n");
         exit(1);
       }
     }
-    frame_parity = !frame_parity;
+
+    if(reading) {
+      VG_WaitIdle(wind);
+      finish_read(wind, readback, read_extent);
+      if(readback.buf != VK_NULL_HANDLE)
+        VG_DestroyBuffer(wind, readback);
+      if(resolved.img != VK_NULL_HANDLE)
+        VG_DestroyImage(wind, resolved);
+      read_wanted = false;
+    }
   }
 
   close(pipe);
   
   VG_WaitIdle(wind);
-  vkResetCommandBuffer(command_buf[0], 0);
-  vkResetCommandBuffer(command_buf[1], 0);
-
+  for(int i = 0; i < VG_MAX_FRAMES; i++)
+    vkResetCommandBuffer(command_buf[i], 0);
+
+  vkDestroyQueryPool(wind->device, timestamps, NULL);
+  wipe_cmds(osk);
+  osDestroyBuffer(osk, line_points);
+  osDestroyBuffer(osk, dense_bins);
+  osDestroyBuffer(osk, dense_series);
+  osDestroyBuffer(osk, strip_series);
+  osDestroyBuffer(osk, strip_draws);
+  free(covered);
   osDestroy(osk);
   VG_DestroyWindow(wind);
   VG_Quit();
@@ -3,6 +3,10 @@
 
 typedef struct Plot Plot;
 Plot * make_plot(int w, int h);
+// make_plot with at most this many msaa samples, which is 16. at 1 lines
+// antialias themselves instead, for a fraction of the memory. points are
+// squares of whole pixels, which need no antialiasing at any count
+Plot * make_plot_msaa(int w, int h, int samples);
 bool plot_alive(Plot * plot);
 void close_plot(Plot * plot);
 
@@ -11,12 +15,83 @@ void plot_color(Plot * plot, float r, float g, float b);
 void plot_point(Plot * plot, float x, float y);
 void plot_points(Plot * plot, int ct, float * xs, float * ys);
 
+// colors a bins_x by bins_y grid over the window by how many points fall in
+// each cell, counted again whenever the view changes. colormap is one of
+// these, or'd with PLOT_LOG for log scaled counts. nothing is plotted
+// unless bins_x and bins_y are both above 0
+enum { PLOT_GRAYS, PLOT_HOT, PLOT_VIRIDIS, PLOT_LOG = 0x100 };
+void plot_density(Plot * plot, int ct, float * xs, float * ys, int bins_x, int bins_y, int colormap);
+
 void plot_line(Plot * plot, float x1, float y1, float x2, float y2);
 void plot_line_strip(Plot * plot, int ct, float * xs, float * ys);
 
-//void plot_bitmap_rgba8(Plot * plot, float x1, float y1, float x2, float y2, int w, int h, bool nearest, const unsigned char * bits);
+// while bins_x is nonzero, line strips whose x only goes up are summed into
+// one density layer on a bins_x by bins_y grid instead of drawn, each strip
+// adding the same amount to every column it crosses however much it wiggles
+// there, and colored with a plot_density colormap. 0 turns it off for
+// the strips plotted after. there's only the one layer, so it's drawn with
+// the grid and colormap last given, strips plotted before them included
+void plot_dense_lines(Plot * plot, int bins_x, int bins_y, int colormap);
+
+// a w by h image of 4 byte rgba pixels stretched over x1 y1 to x2 y2, its
+// first row at the bottom. with nearest, pixels show up as squares when
+// zoomed in instead of being smoothed out. images of any size can be
+// plotted, only the parts in view are sent to the gpu at about the
+// detail the window can show. big ones fill in over a few frames
+void plot_bitmap_rgba8(Plot * plot, float x1, float y1, float x2, float y2, int w, int h, bool nearest, const unsigned char * bits);
+// a w by h grid of floats over x1 y1 to x2 y2 like plot_bitmap_rgba8,
+// colored on the gpu with a plot_density colormap going from vmin to vmax.
+// with PLOT_LOG vmin has to be above 0. nan cells are left out, and
+// zoomed out the cells around them are averaged without them.
+// plot_image_range changes the last one's range and colormap without
+// sending the data again
+void plot_image_f32(Plot * plot, float x1, float y1, float x2, float y2, int w, int h, const float * data, float vmin, float vmax, int colormap);
+void plot_image_range(Plot * plot, float vmin, float vmax, int colormap);
+
+// show just this part of the plot, until plot_autoscale fits the view to
+// everything plotted again
+void plot_view(Plot * plot, float minx, float miny, float maxx, float maxy);
+void plot_autoscale(Plot * plot);
+
+// skip drawing points that land only on pixels already that color. points
+// sit on whole pixels either way, so the picture comes out the same
+void plot_dedupe(Plot * plot, bool on);
 
 void plot_continuous(Plot * plot);
+// when on, new commands are drawn over the last frame instead of redrawing
+// everything, as long as the bounds and the window stay the same
+void plot_accumulate(Plot * plot, bool on);
+// big plots are drawn over several frames, spending about this many
+// milliseconds a frame on it
+void plot_frame_budget(Plot * plot, float ms);
+// how many frames the window can have queued on the gpu at once, up to 4.
+// more lets drawing the next frames overlap the gpu for longer, at the
+// cost of latency. 3 to begin with
+void plot_frames_in_flight(Plot * plot, int frames);
+// how frames reach the screen. vsync doesn't tear, mailbox shows the newest
+// frame at the next vblank and immediate shows it right away, tearing.
+// vsync is used where the others aren't supported
+enum { PLOT_VSYNC, PLOT_MAILBOX, PLOT_IMMEDIATE };
+void plot_present_mode(Plot * plot, int mode);
+// when on, the window waits for the gpu before reading new commands so each
+// frame shows the newest data, at the cost of overlapping cpu and gpu.
+// best with PLOT_MAILBOX
+void plot_low_latency(Plot * plot, bool on);
+// redraw at most this many times a second, for plots in the background.
+// 0, the default, doesn't limit it
+void plot_max_fps(Plot * plot, float fps);
 void plot_clear(Plot * plot);
 void plot_begin_frame(Plot * plot);
 void plot_end_frame(Plot * plot);
+
+// how many display refreshes the plot window let pass without redrawing
+// because nothing changed
+unsigned long plot_skipped_frames(Plot * plot);
+// size of the window's multisampled frame image, and the gpu time the last
+// drawn frame took, for comparing msaa settings
+unsigned long plot_attachment_bytes(Plot * plot);
+float plot_gpu_ms(Plot * plot);
+// waits for the window to draw everything plotted so far and copies its
+// pixels into rgba, 4 bytes each, the top row first. false if the window
+// isn't the size it was made anymore, or has closed
+bool plot_read_pixels(Plot * plot, unsigned char * rgba);
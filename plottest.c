@@ -1,7 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 #include "plot.h"
 
+enum { W = 800, H = 600 };
+
+// dedupe only skips points that wouldn't change a pixel, so the same points
+// have to come out the same with it on and off, with msaa and without
+static int check_dedupe(int samples) {
+  enum { N = 200000 };
+  static float xs[N], ys[N];
+  static unsigned char off[4 * W * H], on[4 * W * H];
+  srand(1);
+  // bunched up so most of them land on top of each other
+  for(int i = 0; i < N; i++) {
+    xs[i] = (rand() + rand()) / (float)RAND_MAX;
+    ys[i] = (rand() + rand()) / (float)RAND_MAX;
+  }
+
+  Plot * p = make_plot_msaa(W, H, samples);
+  bool ok = true;
+  for(int dedupe = 0; dedupe < 2; dedupe++) {
+    plot_clear(p);
+    plot_dedupe(p, dedupe);
+    plot_color(p, 0, 0, 1);
+    plot_points(p, N / 2, xs, ys);
+    plot_color(p, 1, 0, 0);
+    plot_points(p, N / 2, xs + N / 2, ys + N / 2);
+    ok = ok && plot_read_pixels(p, dedupe ? on : off);
+  }
+  close_plot(p);
+  if(!ok) {
+    fprintf(stderr, "failed to read the dedupe check's pixels\n");
+    return 1;
+  }
+
+  int differ = 0;
+  for(int i = 0; i < W * H; i++)
+    differ += on[4 * i] != off[4 * i] || on[4 * i + 1] != off[4 * i + 1] || on[4 * i + 2] != off[4 * i + 2];
+  printf("dedupe at %d samples: %d pixels differ\n", samples, differ);
+  return differ != 0;
+}
+
+// a point cloud's density, a dense lines layer, short strips, a float image
+// with holes and an rgba bitmap side by side. false if the window never
+// finished drawing them or drew nothing
+static bool plot_showcase(Plot * p) {
+  enum { N = 100000, SERIES = 300, LEN = 400, RINGS = 40, RING = 64, IW = 256, IH = 256 };
+  static float xs[N], ys[N];
+  srand(2);
+  for(int i = 0; i < N; i++) {
+    xs[i] = (rand() + rand() + rand()) / (3.0f * RAND_MAX);
+    ys[i] = (rand() + rand() + rand()) / (3.0f * RAND_MAX);
+  }
+  plot_density(p, N, xs, ys, 128, 96, PLOT_VIRIDIS | PLOT_LOG);
+
+  // random walks with x going up, summed instead of drawn one by one
+  plot_dense_lines(p, 256, 96, PLOT_HOT);
+  for(int s = 0; s < SERIES; s++) {
+    float y = 0.5;
+    for(int i = 0; i < LEN; i++) {
+      xs[i] = 1.2 + i / (float)LEN;
+      y += (rand() / (float)RAND_MAX - 0.5) * 0.02;
+      ys[i] = y;
+    }
+    plot_line_strip(p, LEN, xs, ys);
+  }
+  plot_dense_lines(p, 0, 0, 0);
+
+  // short strips are culled and drawn on the gpu a run at a time
+  plot_color(p, 0, 0.4, 0);
+  for(int r = 0; r < RINGS; r++) {
+    float cx = 2.45 + (r % 8) * 0.12, cy = 0.1 + (r / 8) * 0.2;
+    for(int i = 0; i < RING; i++) {
+      xs[i] = cx + 0.05 * cosf(i * 2 * M_PI / (RING - 1));
+      ys[i] = cy + 0.05 * sinf(i * 2 * M_PI / (RING - 1));
+    }
+    plot_line_strip(p, RING, xs, ys);
+  }
+
+  // a ripple with a hole of nans in the middle, and a checkerboard
+  static float ripple[IH][IW];
+  static unsigned char checker[IH][IW][4];
+  for(int y = 0; y < IH; y++) {
+    for(int x = 0; x < IW; x++) {
+      float dx = x - IW / 2, dy = y - IH / 2;
+      float r = sqrtf(dx * dx + dy * dy);
+      ripple[y][x] = r < 20 ? NAN : sinf(r / 8);
+      unsigned char c = ((x / 32) ^ (y / 32)) & 1 ? 255 : 40;
+      checker[y][x][0] = c;
+      checker[y][x][1] = x;
+      checker[y][x][2] = y;
+      checker[y][x][3] = 255;
+    }
+  }
+  plot_image_f32(p, 0, 1.2, 1, 2.2, IW, IH, &ripple[0][0], -1, 1, PLOT_VIRIDIS);
+  // narrower, so the outer rings clip to the colormap's ends
+  plot_image_range(p, -0.5, 0.5, PLOT_HOT);
+  plot_bitmap_rgba8(p, 1.2, 1.2, 2.2, 2.2, IW, IH, true, &checker[0][0][0]);
+
+  static unsigned char pixels[4 * W * H];
+  if(!plot_read_pixels(p, pixels))
+    return false;
+  int drawn = 0;
+  for(int i = 0; i < W * H; i++)
+    drawn += pixels[4 * i] != 255 || pixels[4 * i + 1] != 255 || pixels[4 * i + 2] != 255;
+  printf("showcase: %d pixels drawn\n", drawn);
+  return drawn > 0;
+}
+
 int main() {
-  Plot * p = make_plot(800, 600);
+  int failed = check_dedupe(16) | check_dedupe(1);
+
+  Plot * showcase = make_plot(W, H);
+  if(!plot_showcase(showcase)) {
+    fprintf(stderr, "failed to draw the showcase\n");
+    failed = 1;
+  }
+
+  Plot * p = make_plot(W, H);
 
   plot_line(p, 0, 1, 0, 25);
 
@@ -23,8 +140,10 @@ int main() {
   plot_points(p, sizeof xs / sizeof *xs, xs, ys);
 
 
-  while(plot_alive(p)) {
+  while(plot_alive(p) || plot_alive(showcase)) {
     __builtin_ia32_pause();
   }
   close_plot(p);
+  close_plot(showcase);
+  return failed;
 }
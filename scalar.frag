@@ -0,0 +1,44 @@
+#version 450
+layout(location = 0) in vec2 vs_uv;
+layout(location = 0) out vec4 fs_color;
+
+layout(set = 0, binding = 0) uniform sampler2D tex;
+
+// after the part of the push constants the vertex shaders use
+layout(push_constant) uniform PerDraw {
+  layout(offset = 104) int colormap;
+  int bins_x;
+  int bins_y;
+  int log_scale;
+  float lo;
+  float hi;
+};
+
+// the same stops as density.frag, in the order of the colormap enum
+const vec3 stops[3][5] = vec3[][](
+  vec3[](vec3(0.85), vec3(0.64), vec3(0.43), vec3(0.21), vec3(0)),
+  vec3[](vec3(0.5, 0, 0), vec3(0.9, 0.1, 0), vec3(1, 0.5, 0), vec3(1, 0.85, 0.1), vec3(1, 1, 0.6)),
+  vec3[](vec3(0.267, 0.005, 0.329), vec3(0.229, 0.322, 0.546), vec3(0.128, 0.567, 0.551), vec3(0.369, 0.789, 0.383), vec3(0.993, 0.906, 0.144))
+);
+
+void main() {
+  float v = texture(tex, vs_uv).r;
+  // a nan next to it filters to nan too, the nearest texel of the level
+  // keeps holes the size they are. those show the background
+  if(isnan(v)) {
+    int level = int(textureQueryLod(tex, vs_uv).x + 0.5);
+    ivec2 size = textureSize(tex, level);
+    v = texelFetch(tex, clamp(ivec2(vs_uv * size), ivec2(0), size - 1), level).r;
+  }
+  if(isnan(v))
+    discard;
+
+  float t;
+  if(log_scale != 0)
+    t = log(max(v, lo) / lo) / log(hi / lo);
+  else
+    t = hi != lo ? (v - lo) / (hi - lo) : 0.5;
+  float s = clamp(t, 0, 1) * 4;
+  int i = min(int(s), 3);
+  fs_color = vec4(mix(stops[colormap][i], stops[colormap][i + 1], s - i), 1);
+}
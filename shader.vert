@@ -4,11 +4,20 @@ layout(location = 1) in vec4 color;
 
 layout(location = 0) out vec4 vs_color;
 
+layout(constant_id = 0) const bool points = false;
+
 layout(push_constant) uniform PerDraw {
   mat4 mvp;
+  vec4 draw_color; // unused, the color is per vertex
+  vec2 line_size;
+  float aspect;
+  int first;
+  float point_size;
 };
 
 void main() {
   gl_Position = mvp * pos;
   vs_color = color;
+  if(points)
+    gl_PointSize = point_size;
 }
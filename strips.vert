@@ -0,0 +1,84 @@
+#version 450
+// line.vert for many strips in one indirect draw, each draw's instance
+// being its series
+layout(std430, set = 0, binding = 0) readonly buffer Points {
+  vec2 points[];
+};
+
+struct Series {
+  vec4 bounds;
+  vec4 color;
+  int first;
+  int count;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer SeriesList {
+  Series series[];
+};
+
+layout(location = 0) out vec4 vs_color;
+layout(location = 1) out float vs_edge;
+layout(location = 2) flat out float vs_half_width;
+
+layout(constant_id = 1) const bool smooth_lines = false;
+
+layout(push_constant) uniform PerDraw {
+  mat4 mvp;
+  vec4 color;
+  vec2 line_size;
+  float aspect;
+  int first;
+  float point_size;
+  float line_width;
+};
+
+const ivec2 corners[6] = ivec2[](
+  ivec2(0, -1), ivec2(1, -1), ivec2(1, +1),
+  ivec2(0, -1), ivec2(1, +1), ivec2(0, +1)
+);
+
+const float miter_limit = 4;
+
+vec4 project(int i) {
+  return mvp * vec4(points[i], 0, 1);
+}
+
+vec2 segment_normal(vec4 s0, vec4 s1) {
+  vec2 tangent = vec2(s1.x - s0.x, (s1.y - s0.y) / aspect);
+  float len = length(tangent);
+  tangent = len > 0 ? tangent / len : vec2(1, 0);
+  return vec2(-tangent.y, tangent.x);
+}
+
+vec2 miter(vec2 a, vec2 b) {
+  vec2 m = a + b;
+  float len = length(m);
+  if(len < 1e-6)
+    return a;
+  m /= len;
+  return m / max(dot(m, a), 1 / miter_limit);
+}
+
+void main() {
+  Series s = series[gl_InstanceIndex];
+  int segment = gl_VertexIndex / 6;
+  ivec2 corner = corners[gl_VertexIndex % 6];
+  int i = s.first + segment;
+
+  vec4 s0 = project(i);
+  vec4 s1 = project(i + 1);
+
+  vec2 normal = segment_normal(s0, s1);
+  vec2 offset = normal;
+  if(corner.x == 0 && segment > 0)
+    offset = miter(segment_normal(project(i - 1), s0), normal);
+  else if(corner.x == 1 && segment + 2 < s.count)
+    offset = miter(normal, segment_normal(s1, project(i + 2)));
+
+  gl_Position = (corner.x == 0 ? s0 : s1) + vec4(corner.y * offset * line_size, 0, 0);
+  vs_color = s.color;
+  if(smooth_lines) {
+    vs_half_width = line_width / 2;
+    vs_edge = corner.y * (vs_half_width + 1);
+  }
+}
@@ -0,0 +1,9 @@
+#version 450
+layout(location = 0) in vec2 vs_uv;
+layout(location = 0) out vec4 fs_color;
+
+layout(set = 0, binding = 0) uniform sampler2D tex;
+
+void main() {
+  fs_color = texture(tex, vs_uv);
+}
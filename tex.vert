@@ -0,0 +1,22 @@
+#version 450
+layout(location = 0) out vec2 vs_uv;
+
+// rect and uv are x1 y1 x2 y2, over the color and line sizes of the other
+// shaders
+layout(push_constant) uniform PerDraw {
+  mat4 mvp;
+  vec4 rect;
+  vec4 uv;
+};
+
+// two triangles
+const vec2 corners[6] = vec2[](
+  vec2(0, 0), vec2(1, 0), vec2(1, 1),
+  vec2(0, 0), vec2(1, 1), vec2(0, 1)
+);
+
+void main() {
+  vec2 c = corners[gl_VertexIndex];
+  gl_Position = mvp * vec4(mix(rect.xy, rect.zw, c), 0, 1);
+  vs_uv = mix(uv.xy, uv.zw, c);
+}
@@ -1,5 +1,5 @@
 (define-library (vanity plot)
-  (export make-plot close-plot plot-alive? plot-color plot-point plot-points plot-line plot-line-strip plot-continuous plot-clear plot-begin-frame plot-end-frame)
+  (export make-plot make-plot-msaa close-plot plot-alive? plot-color plot-point plot-points plot-density plot-grays plot-hot plot-viridis plot-log plot-line plot-line-strip plot-dense-lines plot-bitmap-rgba8 plot-image-f32 plot-image-range plot-view plot-autoscale plot-dedupe plot-continuous plot-accumulate plot-frame-budget plot-frames-in-flight plot-present-mode plot-vsync plot-mailbox plot-immediate plot-low-latency plot-max-fps plot-clear plot-begin-frame plot-end-frame plot-skipped-frames plot-attachment-bytes plot-gpu-ms)
   (import (vanity core))
   (##foreign.import "C" "plot.h")
 
@@ -7,6 +7,10 @@
     (let ((plot (make_plot x y)))
       (##vcore.set-finalizer! plot (lambda (plot) (close_plot plot)))
       plot))
+  (define (make-plot-msaa x y samples)
+    (let ((plot (make_plot_msaa x y samples)))
+      (##vcore.set-finalizer! plot (lambda (plot) (close_plot plot)))
+      plot))
   (define plot-alive? plot_alive)
   (define (close-plot plot)
     (##vcore.finalize! plot))
@@ -19,6 +23,17 @@
       (if (not (= lena lenb))
           (error "plot-points: xs and ys are not equal length"))
       (plot_points plot lena xs ys)))
+  ; colormaps for plot-density, add plot-log for log scaled counts
+  (define plot-grays 0)
+  (define plot-hot 1)
+  (define plot-viridis 2)
+  (define plot-log 256)
+  (define (plot-density plot xs ys bins-x bins-y colormap)
+    (let ((lena (f32vector-length xs))
+          (lenb (f32vector-length ys)))
+      (if (not (= lena lenb))
+          (error "plot-density: xs and ys are not equal length"))
+      (plot_density plot lena xs ys bins-x bins-y colormap)))
   (define (plot-line plot x1 y1 x2 y2)
     (plot_line plot x1 y1 x2 y2))
   (define (plot-line-strip plot xs ys)
@@ -27,7 +42,33 @@
       (if (not (= lena lenb))
           (error "plot-points: xs and ys are not equal length"))
       (plot_line_strip plot lena xs ys)))
+  (define plot-dense-lines plot_dense_lines)
+  (define (plot-bitmap-rgba8 plot x1 y1 x2 y2 w h nearest bits)
+    (if (not (= (bytevector-length bits) (* 4 w h)))
+        (error "plot-bitmap-rgba8: bits is not 4 * w * h bytes"))
+    (plot_bitmap_rgba8 plot x1 y1 x2 y2 w h nearest bits))
+  (define (plot-image-f32 plot x1 y1 x2 y2 w h data vmin vmax colormap)
+    (if (not (= (f32vector-length data) (* w h)))
+        (error "plot-image-f32: data is not w * h floats"))
+    (plot_image_f32 plot x1 y1 x2 y2 w h data vmin vmax colormap))
+  (define plot-image-range plot_image_range)
+  (define plot-view plot_view)
+  (define plot-autoscale plot_autoscale)
+  (define plot-dedupe plot_dedupe)
   (define plot-continuous plot-continuous)
+  (define plot-accumulate plot_accumulate)
+  (define plot-frame-budget plot_frame_budget)
+  (define plot-frames-in-flight plot_frames_in_flight)
+  ; modes for plot-present-mode
+  (define plot-vsync 0)
+  (define plot-mailbox 1)
+  (define plot-immediate 2)
+  (define plot-present-mode plot_present_mode)
+  (define plot-low-latency plot_low_latency)
+  (define plot-max-fps plot_max_fps)
   (define plot-clear plot_clear)
   (define plot-begin-frame plot_begin_frame)
-  (define plot-end-frame plot_end_frame))
+  (define plot-end-frame plot_end_frame)
+  (define plot-skipped-frames plot_skipped_frames)
+  (define plot-attachment-bytes plot_attachment_bytes)
+  (define plot-gpu-ms plot_gpu_ms))
@@ -21,6 +21,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
+#include <assert.h>
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_vulkan.h>
 
@@ -65,6 +67,8 @@ typedef struct QueriedDevice {
   
   uint32_t graphics_index;
   uint32_t present_index;
+  // UINT32_MAX if there's no family for just transfers
+  uint32_t transfer_index;
 
   VkSampleCountFlagBits msaa_samples;
 } QueriedDevice;
@@ -87,6 +91,19 @@ QueriedDevice score_gpu(VkPhysicalDevice device, VkSurfaceKHR surf) {
 
     VkSampleCountFlags numsamples = deviceProps.limits.framebufferColorSampleCounts & deviceProps.limits.framebufferDepthSampleCounts;
 
+    // frames in flight are tracked with a timeline semaphore
+    VkPhysicalDeviceVulkan12Features feats12 = {
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+    };
+    VkPhysicalDeviceFeatures2 feats2 = {
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+      .pNext = &feats12,
+    };
+    if(deviceProps.apiVersion >= VK_API_VERSION_1_2)
+      vkGetPhysicalDeviceFeatures2(device, &feats2);
+    if(!feats12.timelineSemaphore)
+      suitable = false;
+
     uint32_t queueFamilyCount;
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, NULL);
     VkQueueFamilyProperties queueFamilies[queueFamilyCount];
@@ -94,11 +111,16 @@ QueriedDevice score_gpu(VkPhysicalDevice device, VkSurfaceKHR surf) {
 
     uint32_t graphicsQueueIndex = UINT32_MAX;
     uint32_t presentQueueIndex = UINT32_MAX;
+    uint32_t transferQueueIndex = UINT32_MAX;
     VkBool32 support;
     for (uint32_t i = 0; i < queueFamilyCount; i++) {
       VkQueueFamilyProperties queueFamily = queueFamilies[i];
       if (graphicsQueueIndex == UINT32_MAX && queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT)
         graphicsQueueIndex = i;
+      // usually the copy engine, which runs alongside everything else
+      if (transferQueueIndex == UINT32_MAX && queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT &&
+          !(queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+        transferQueueIndex = i;
       if (presentQueueIndex == UINT32_MAX) {
         vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surf, &support);
         if(support)
@@ -114,6 +136,7 @@ QueriedDevice score_gpu(VkPhysicalDevice device, VkSurfaceKHR surf) {
       .score = score * suitable,
       .graphics_index = graphicsQueueIndex,
       .present_index = presentQueueIndex,
+      .transfer_index = transferQueueIndex,
       .msaa_samples = numsamples,
     };
 }
@@ -176,7 +199,7 @@ QueriedDevice VG_SelectPhysicalDevice(VGWindow * wind) {
   return ret;
 }
 
-VGWindow * VG_CreateWindow(int w, int h) {
+VGWindow * VG_CreateWindow(int w, int h, uint32_t samples) {
   VGWindow * wind = malloc(sizeof(VGWindow));
   wind->window = SDL_CreateWindow("Vanity Plot", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, w, h, SDL_WINDOW_SHOWN | SDL_WINDOW_VULKAN | SDL_WINDOW_RESIZABLE);
 
@@ -206,11 +229,15 @@ VGWindow * VG_CreateWindow(int w, int h) {
   }
 
 
+  VkApplicationInfo appInfo = {
+    .sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
+    .apiVersion = VK_API_VERSION_1_2,
+  };
   const VkInstanceCreateInfo instInfo = {
     .sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
     .pNext = NULL,
     .flags = 0,
-    .pApplicationInfo = NULL,
+    .pApplicationInfo = &appInfo,
     .enabledLayerCount = found_validation ? 1 : 0,
     .ppEnabledLayerNames = &validation_layer,
     .enabledExtensionCount = instanceExtensionCount,
@@ -251,13 +278,26 @@ VGWindow * VG_CreateWindow(int w, int h) {
     fprintf(stderr, "failed to find suitable device supporting vulkan\n");
     return NULL;
   }
+  vkGetPhysicalDeviceMemoryProperties(wind->physical_device, &wind->mem_props);
+  wind->numblocks = 0;
+  wind->blockssize = 0;
+  wind->blocks = NULL;
+  wind->slot = 0;
+  for(int i = 0; i < VG_MAX_FRAMES; i++) {
+    wind->transient[i] = NULL;
+    wind->transient_used[i] = 0;
+    wind->transient_want[i] = 0;
+  }
 
   uint32_t graphicsQueueIndex = queried_device.graphics_index;
   uint32_t presentQueueIndex = queried_device.present_index;
   wind->graphics_queue_index = graphicsQueueIndex;
   wind->present_queue_index = presentQueueIndex;
+  wind->transfer_queue_index = queried_device.transfer_index;
 
   uint32_t msaa_samples = 16;
+  while(msaa_samples > samples)
+    msaa_samples /= 2;
   while(!(msaa_samples & queried_device.msaa_samples))
     msaa_samples /= 2;
   if(!msaa_samples)
@@ -265,32 +305,53 @@ VGWindow * VG_CreateWindow(int w, int h) {
   wind->msaa_samples = msaa_samples;
 
   float queuePriority = 1.0f;
-  VkDeviceQueueCreateInfo queueInfos[] = {
-    {
-      .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
-      .pNext = NULL,
-      .flags = 0,
-      .queueFamilyIndex = graphicsQueueIndex,
-      .queueCount = 1,
-      .pQueuePriorities = &queuePriority,
-    },
-    {
+  uint32_t queueIndices[] = { graphicsQueueIndex, presentQueueIndex, wind->transfer_queue_index };
+  uint32_t queueInfoCount = 0;
+  VkDeviceQueueCreateInfo queueInfos[3];
+  for(int i = 0; i < 3; i++) {
+    bool seen = queueIndices[i] == UINT32_MAX;
+    for(int j = 0; j < i; j++)
+      seen = seen || queueIndices[j] == queueIndices[i];
+    if(seen)
+      continue;
+    queueInfos[queueInfoCount++] = (VkDeviceQueueCreateInfo) {
       .sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
       .pNext = NULL,
       .flags = 0,
-      .queueFamilyIndex = presentQueueIndex,
+      .queueFamilyIndex = queueIndices[i],
       .queueCount = 1,
       .pQueuePriorities = &queuePriority,
-    },
-  };
+    };
+  }
   
-  VkPhysicalDeviceFeatures deviceFeatures = { 0 };
+  // many draws from one indirect buffer, each finding its data by its
+  // instance, and with the count read off the gpu too where it can be
+  VkPhysicalDeviceVulkan12Features supported12 = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+  };
+  VkPhysicalDeviceFeatures2 supported = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+    .pNext = &supported12,
+  };
+  vkGetPhysicalDeviceFeatures2(wind->physical_device, &supported);
+  wind->draw_indirect = supported.features.multiDrawIndirect && supported.features.drawIndirectFirstInstance;
+  wind->draw_indirect_count = wind->draw_indirect && supported12.drawIndirectCount;
+
+  VkPhysicalDeviceFeatures deviceFeatures = {
+    .multiDrawIndirect = wind->draw_indirect,
+    .drawIndirectFirstInstance = wind->draw_indirect,
+  };
+  VkPhysicalDeviceVulkan12Features deviceFeatures12 = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+    .timelineSemaphore = VK_TRUE,
+    .drawIndirectCount = wind->draw_indirect_count,
+  };
   const char* deviceExtensionNames[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
   VkDeviceCreateInfo createInfo = {
     VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,   // sType
-    NULL,                                // pNext
+    &deviceFeatures12,                      // pNext
     0,                                      // flags
-    graphicsQueueIndex == presentQueueIndex ? 1 : 2,                                      // queueCreateInfoCount
+    queueInfoCount,                         // queueCreateInfoCount
     queueInfos,                             // pQueueCreateInfos
     0,                                      // enabledLayerCount
     NULL,                                // ppEnabledLayerNames
@@ -302,6 +363,9 @@ VGWindow * VG_CreateWindow(int w, int h) {
 
   vkGetDeviceQueue(wind->device, graphicsQueueIndex, 0, &wind->graphics_queue);
   vkGetDeviceQueue(wind->device, presentQueueIndex, 0, &wind->present_queue);
+  wind->transfer_queue = VK_NULL_HANDLE;
+  if(wind->transfer_queue_index != UINT32_MAX)
+    vkGetDeviceQueue(wind->device, wind->transfer_queue_index, 0, &wind->transfer_queue);
 
   return wind;
 }
@@ -386,40 +450,217 @@ int VG_CreateAppObjects(VGWindow * wind) {
       fprintf(stderr, "failed to create command pool\n");
       return 1;
     }
+
+    wind->transfer_pool = VK_NULL_HANDLE;
+    createInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    createInfo.queueFamilyIndex = wind->transfer_queue_index;
+    if(wind->transfer_queue != VK_NULL_HANDLE &&
+       vkCreateCommandPool(wind->device, &createInfo, NULL, &wind->transfer_pool) != VK_SUCCESS) {
+      fprintf(stderr, "failed to create command pool\n");
+      return 1;
+    }
   }
 
   {
     VkSemaphoreCreateInfo semaphoreInfo = {
       .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
     };
-    VkFenceCreateInfo fenceInfo = {
-      .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-      .flags = VK_FENCE_CREATE_SIGNALED_BIT,
-    };
-    for(int i = 0; i < 2; i++) {
+    for(int i = 0; i < VG_MAX_FRAMES; i++) {
       if(vkCreateSemaphore(wind->device, &semaphoreInfo, NULL, &wind->image_available[i]) != VK_SUCCESS ||
-         vkCreateSemaphore(wind->device, &semaphoreInfo, NULL, &wind->render_finished[i]) != VK_SUCCESS ||
-         vkCreateFence(wind->device, &fenceInfo, NULL, &wind->frame_fence[i]) != VK_SUCCESS) {
+         vkCreateSemaphore(wind->device, &semaphoreInfo, NULL, &wind->render_finished[i]) != VK_SUCCESS) {
         fprintf(stderr, "failed to create sync objects\n");
         return 1;
       }
+      wind->slot_frame[i] = 0;
+    }
+
+    VkSemaphoreTypeCreateInfo typeInfo = {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+      .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+      .initialValue = 0,
+    };
+    semaphoreInfo.pNext = &typeInfo;
+    if(vkCreateSemaphore(wind->device, &semaphoreInfo, NULL, &wind->frame_timeline) != VK_SUCCESS ||
+       vkCreateSemaphore(wind->device, &semaphoreInfo, NULL, &wind->upload_timeline) != VK_SUCCESS) {
+      fprintf(stderr, "failed to create sync objects\n");
+      return 1;
     }
+    wind->frame_count = 0;
+    wind->upload_count = 0;
+    wind->upload_wait = 0;
+    // enough for the cpu to work on a frame while the gpu has the two before
+    wind->frames_in_flight = 3;
   }
   wind->swapchain_created = false;
+  wind->present_mode = VK_PRESENT_MODE_FIFO_KHR;
+  wind->swapchain = VK_NULL_HANDLE;
+  wind->num_swapimages = 0;
+  wind->swapimages = NULL;
+  wind->swapviews = NULL;
+  wind->primary_frameimage = (VGImage) { VK_NULL_HANDLE };
+  wind->spare_frameimage = (VGImage) { VK_NULL_HANDLE };
+  wind->frame_extent = (VkExtent2D) { 0, 0 };
+  wind->spare_extent = (VkExtent2D) { 0, 0 };
+  wind->num_retired = 0;
   return 0;
 }
 
 static uint32_t VG_FindMemoryType(VGWindow * wind, uint32_t filter, VkMemoryPropertyFlags properties) {
-  VkPhysicalDeviceMemoryProperties memProperties;
-  vkGetPhysicalDeviceMemoryProperties(wind->physical_device, &memProperties);
+  VkPhysicalDeviceMemoryProperties * memProperties = &wind->mem_props;
 
-  for(uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-    if(filter & (1 << i) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
+  for(uint32_t i = 0; i < memProperties->memoryTypeCount; i++) {
+    if(filter & (1 << i) && (memProperties->memoryTypes[i].propertyFlags & properties) == properties)
       return i;
   }
   return ~0u;
 }
 
+static VGMemBlock * VG_CreateBlock(VGWindow * wind, VkDeviceSize size, uint32_t type, bool optimal) {
+  VkMemoryAllocateInfo allocInfo = {
+    .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+    .allocationSize = size,
+    .memoryTypeIndex = type,
+  };
+  VkDeviceMemory mem;
+  if(vkAllocateMemory(wind->device, &allocInfo, NULL, &mem) != VK_SUCCESS)
+    return NULL;
+
+  VGMemBlock * block = malloc(sizeof(VGMemBlock));
+  *block = (VGMemBlock) {
+    .mem = mem,
+    .size = size,
+    .type = type,
+    .optimal = optimal,
+    .numfree = 1,
+    .freesize = 1,
+    .free = malloc(sizeof(VGMemRange)),
+  };
+  block->free[0] = (VGMemRange) { 0, size };
+  if(wind->mem_props.memoryTypes[type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    vkMapMemory(wind->device, mem, 0, size, 0, &block->map);
+  return block;
+}
+
+static void VG_DestroyBlock(VGWindow * wind, VGMemBlock * block) {
+  if(block == NULL)
+    return;
+  vkFreeMemory(wind->device, block->mem, NULL);
+  free(block->free);
+  free(block);
+}
+
+static void VG_ReserveRanges(VGMemBlock * block, int num) {
+  if(num <= block->freesize)
+    return;
+  block->freesize = 2 * num;
+  block->free = realloc(block->free, sizeof(VGMemRange[block->freesize]));
+}
+
+// first fit. the bit alignment skips stays free
+static bool VG_BlockAlloc(VGMemBlock * block, VkMemoryRequirements reqs, VkDeviceSize * offset) {
+  for(int i = 0; i < block->numfree; i++) {
+    VGMemRange r = block->free[i];
+    VkDeviceSize lo = (r.lo + reqs.alignment - 1) / reqs.alignment * reqs.alignment;
+    VkDeviceSize hi = lo + reqs.size;
+    if(hi > r.hi)
+      continue;
+
+    if(lo > r.lo && hi < r.hi) {
+      VG_ReserveRanges(block, block->numfree + 1);
+      memmove(&block->free[i+2], &block->free[i+1], sizeof(VGMemRange[block->numfree - i - 1]));
+      block->free[i] = (VGMemRange) { r.lo, lo };
+      block->free[i+1] = (VGMemRange) { hi, r.hi };
+      block->numfree++;
+    } else if(lo > r.lo) {
+      block->free[i].hi = lo;
+    } else if(hi < r.hi) {
+      block->free[i].lo = hi;
+    } else {
+      memmove(&block->free[i], &block->free[i+1], sizeof(VGMemRange[block->numfree - i - 1]));
+      block->numfree--;
+    }
+    block->numallocs++;
+    *offset = lo;
+    return true;
+  }
+  return false;
+}
+
+static void VG_BlockFree(VGMemBlock * block, VkDeviceSize lo, VkDeviceSize hi) {
+  int i = 0;
+  while(i < block->numfree && block->free[i].lo < lo)
+    i++;
+  bool joinprev = i > 0 && block->free[i-1].hi == lo;
+  bool joinnext = i < block->numfree && block->free[i].lo == hi;
+  if(joinprev && joinnext) {
+    block->free[i-1].hi = block->free[i].hi;
+    memmove(&block->free[i], &block->free[i+1], sizeof(VGMemRange[block->numfree - i - 1]));
+    block->numfree--;
+  } else if(joinprev) {
+    block->free[i-1].hi = hi;
+  } else if(joinnext) {
+    block->free[i].lo = lo;
+  } else {
+    VG_ReserveRanges(block, block->numfree + 1);
+    memmove(&block->free[i+1], &block->free[i], sizeof(VGMemRange[block->numfree - i]));
+    block->free[i] = (VGMemRange) { lo, hi };
+    block->numfree++;
+  }
+  block->numallocs--;
+}
+
+// finds room in a block of the right memory type and kind, making a new
+// block if none have it
+static VGMemBlock * VG_AllocMemory(VGWindow * wind, VkMemoryRequirements reqs, VkMemoryPropertyFlags props, bool optimal, VkDeviceSize * offset) {
+  uint32_t type = VG_FindMemoryType(wind, reqs.memoryTypeBits, props);
+  if(type == ~0u)
+    return NULL;
+
+  bool dedicated = reqs.size > VG_MEM_BLOCK / 2;
+  if(!dedicated) {
+    for(int i = 0; i < wind->numblocks; i++) {
+      VGMemBlock * block = wind->blocks[i];
+      if(block->type == type && block->optimal == optimal && VG_BlockAlloc(block, reqs, offset))
+        return block;
+    }
+  }
+
+  VGMemBlock * block = VG_CreateBlock(wind, dedicated ? reqs.size : VG_MEM_BLOCK, type, optimal);
+  if(block == NULL)
+    return NULL;
+  if(wind->numblocks == wind->blockssize) {
+    wind->blockssize = wind->blockssize ? 2 * wind->blockssize : 16;
+    wind->blocks = realloc(wind->blocks, sizeof(VGMemBlock *[wind->blockssize]));
+  }
+  wind->blocks[wind->numblocks++] = block;
+  VG_BlockAlloc(block, reqs, offset);
+  return block;
+}
+
+static void VG_FreeMemory(VGWindow * wind, VGMemBlock * block, VkDeviceSize offset, VkDeviceSize size) {
+  if(block == NULL || block->transient)
+    return;
+  VG_BlockFree(block, offset, offset + size);
+  if(block->numallocs)
+    return;
+
+  // empty blocks go back, except one of each kind to save churning them
+  int index = -1;
+  bool keep = block->size == VG_MEM_BLOCK;
+  for(int i = 0; i < wind->numblocks; i++) {
+    VGMemBlock * b = wind->blocks[i];
+    if(b == block)
+      index = i;
+    else if(b->type == block->type && b->optimal == block->optimal && b->numallocs == 0)
+      keep = false;
+  }
+  if(keep)
+    return;
+  assert(index >= 0);
+  wind->blocks[index] = wind->blocks[--wind->numblocks];
+  VG_DestroyBlock(wind, block);
+}
+
 VGImage VG_CreateImageImpl(VGWindow * wind, uint32_t w, uint32_t h, uint32_t levels, VkSampleCountFlagBits num_samples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags props) {
   VGImage ret = { VK_NULL_HANDLE, VK_NULL_HANDLE };
 
@@ -444,16 +685,15 @@ VGImage VG_CreateImageImpl(VGWindow * wind, uint32_t w, uint32_t h, uint32_t lev
   }
   VkMemoryRequirements memReqs;
   vkGetImageMemoryRequirements(wind->device, ret.img, &memReqs);
-  VkMemoryAllocateInfo allocInfo = {
-    .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-    .allocationSize = memReqs.size,
-    .memoryTypeIndex = VG_FindMemoryType(wind, memReqs.memoryTypeBits, props),
-  };
-  if(vkAllocateMemory(wind->device, &allocInfo, NULL, &ret.mem)) {
-    ret.mem = VK_NULL_HANDLE;
+  ret.block = VG_AllocMemory(wind, memReqs, props, tiling == VK_IMAGE_TILING_OPTIMAL, &ret.offset);
+  if(ret.block == NULL) {
+    vkDestroyImage(wind->device, ret.img, NULL);
+    ret.img = VK_NULL_HANDLE;
     return ret;
   }
-  vkBindImageMemory(wind->device, ret.img, ret.mem, 0);
+  ret.mem = ret.block->mem;
+  ret.size = memReqs.size;
+  vkBindImageMemory(wind->device, ret.img, ret.mem, ret.offset);
 
   VkImageViewCreateInfo viewInfo = {
     .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
@@ -477,7 +717,7 @@ VGImage VG_CreateImageImpl(VGWindow * wind, uint32_t w, uint32_t h, uint32_t lev
 void VG_DestroyImage(VGWindow * wind, VGImage img) {
   vkDestroyImageView(wind->device, img.view, NULL);
   vkDestroyImage(wind->device, img.img, NULL);
-  vkFreeMemory(wind->device, img.mem, NULL);
+  VG_FreeMemory(wind, img.block, img.offset, img.size);
 }
 
 VGBuffer VG_CreateBufferImpl(VGWindow * wind, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) {
@@ -496,31 +736,254 @@ VGBuffer VG_CreateBufferImpl(VGWindow * wind, VkDeviceSize size, VkBufferUsageFl
   VkMemoryRequirements memReqs;
   vkGetBufferMemoryRequirements(wind->device, ret.buf, &memReqs);
 
-  VkMemoryAllocateInfo allocInfo = {
-    .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
-    .allocationSize = memReqs.size,
-    .memoryTypeIndex = VG_FindMemoryType(wind, memReqs.memoryTypeBits, properties ),
-  };
-  if(vkAllocateMemory(wind->device, &allocInfo, NULL, &ret.mem) != VK_SUCCESS) {
+  ret.block = VG_AllocMemory(wind, memReqs, properties, false, &ret.offset);
+  if(ret.block == NULL) {
     vkDestroyBuffer(wind->device, ret.buf, NULL);
     ret.buf = VK_NULL_HANDLE;
     return ret;
   }
+  ret.mem = ret.block->mem;
   ret.size = memReqs.size;
-  vkBindBufferMemory(wind->device, ret.buf, ret.mem, 0);
+  ret.map = ret.block->map ? ret.block->map + ret.offset : NULL;
+  vkBindBufferMemory(wind->device, ret.buf, ret.mem, ret.offset);
+  return ret;
+}
+
+VGBuffer VG_CreateTransientBuffer(VGWindow * wind, VkDeviceSize size, VkBufferUsageFlags usage) {
+  VkMemoryPropertyFlags props = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  VGBuffer ret = { VK_NULL_HANDLE, VK_NULL_HANDLE };
+
+  VkBufferCreateInfo bufferInfo = {
+    .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+    .size = size,
+    .usage = usage,
+    .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+  };
+  if(vkCreateBuffer(wind->device, &bufferInfo, NULL, &ret.buf) != VK_SUCCESS) {
+    return ret;
+  }
+  VkMemoryRequirements memReqs;
+  vkGetBufferMemoryRequirements(wind->device, ret.buf, &memReqs);
+
+  uint32_t slot = wind->slot;
+  VGMemBlock * block = wind->transient[slot];
+  VkDeviceSize used = wind->transient_used[slot];
+  VkDeviceSize offset = (used + memReqs.alignment - 1) / memReqs.alignment * memReqs.alignment;
+  if(wind->transient_want[slot] < offset + memReqs.size)
+    wind->transient_want[slot] = offset + memReqs.size;
+
+  // the slot's last frame is done with its block, so before anything is
+  // taken from it this frame it can be swapped for one big enough
+  if(used == 0 && (block == NULL || block->size < wind->transient_want[slot] ||
+                   !(memReqs.memoryTypeBits & (1u << block->type)))) {
+    VG_DestroyBlock(wind, block);
+    VkDeviceSize blocksize = VG_MEM_BLOCK / 16;
+    while(blocksize < wind->transient_want[slot])
+      blocksize *= 2;
+    uint32_t type = VG_FindMemoryType(wind, memReqs.memoryTypeBits, props);
+    block = type == ~0u ? NULL : VG_CreateBlock(wind, blocksize, type, false);
+    if(block)
+      block->transient = true;
+    wind->transient[slot] = block;
+  }
+
+  if(block == NULL || offset + memReqs.size > block->size ||
+     !(memReqs.memoryTypeBits & (1u << block->type))) {
+    // out of room this frame, next time round the block will be bigger
+    vkDestroyBuffer(wind->device, ret.buf, NULL);
+    return VG_CreateBufferImpl(wind, size, usage, props);
+  }
+  wind->transient_used[slot] = offset + memReqs.size;
+  ret.block = block;
+  ret.offset = offset;
+  ret.mem = block->mem;
+  ret.size = memReqs.size;
+  ret.map = block->map + offset;
+  vkBindBufferMemory(wind->device, ret.buf, ret.mem, ret.offset);
   return ret;
 }
 
 void VG_DestroyBuffer(VGWindow * wind, VGBuffer buf) {
   vkDestroyBuffer(wind->device, buf.buf, NULL);
-  vkFreeMemory(wind->device, buf.mem, NULL);
+  VG_FreeMemory(wind, buf.block, buf.offset, buf.size);
+}
+
+// frame images come in multiples of this many pixels each way
+enum { VG_FRAME_BUCKET = 256 };
+
+static VkExtent2D VG_FrameBucket(VkExtent2D extent) {
+  VkExtent2D ret = {
+    (extent.width + VG_FRAME_BUCKET - 1) / VG_FRAME_BUCKET * VG_FRAME_BUCKET,
+    (extent.height + VG_FRAME_BUCKET - 1) / VG_FRAME_BUCKET * VG_FRAME_BUCKET,
+  };
+  return ret;
 }
 
 VGImage Create_PrimaryFrameimage(VGWindow * wind) {
-  VGImage img = VG_CreateImageImpl(wind, wind->swap_extent.width, wind->swap_extent.height, 1, wind->msaa_samples, wind->swapformat.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  VGImage img = VG_CreateImageImpl(wind, wind->frame_extent.width, wind->frame_extent.height, 1, wind->msaa_samples, wind->swapformat.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
   return img;
 }
 
+// queues the current swapchain objects for VG_CollectRetired. the frame
+// image only goes along when it's the wrong size for the new extent
+static void VG_RetireSwapchain(VGWindow * wind, bool frameimage) {
+  if(wind->num_retired == VG_MAX_RETIRED) {
+    VG_WaitFrame(wind, wind->frame_count);
+    VG_CollectRetired(wind);
+  }
+  VGRetired * r = &wind->retired[wind->num_retired++];
+  *r = (VGRetired) {
+    .swapchain = wind->swapchain,
+    .num_swapimages = wind->num_swapimages,
+    .swapimages = wind->swapimages,
+    .swapviews = wind->swapviews,
+    .framebuffer = wind->primary_framebuffer,
+    .frameimage = { VK_NULL_HANDLE },
+    .frame = wind->frame_count,
+  };
+  if(frameimage) {
+    r->frameimage = wind->primary_frameimage;
+    r->frame_extent = wind->frame_extent;
+    wind->primary_frameimage = (VGImage) { VK_NULL_HANDLE };
+  }
+
+  wind->swapchain = VK_NULL_HANDLE;
+  wind->num_swapimages = 0;
+  wind->swapimages = NULL;
+  wind->swapviews = NULL;
+  wind->primary_framebuffer = VK_NULL_HANDLE;
+  wind->swapchain_created = false;
+}
+
+static void VG_DestroyRetired(VGWindow * wind, VGRetired * r) {
+  VkDevice device = wind->device;
+  vkDestroyFramebuffer(device, r->framebuffer, NULL);
+  for(int i = 0; i < r->num_swapimages; i++)
+    vkDestroyImageView(device, r->swapviews[i], NULL);
+  vkDestroySwapchainKHR(device, r->swapchain, NULL);
+  free(r->swapviews);
+  free(r->swapimages);
+
+  // the newest frame image given up is kept as the spare
+  if(r->frameimage.img != VK_NULL_HANDLE) {
+    VG_DestroyImage(wind, wind->spare_frameimage);
+    wind->spare_frameimage = r->frameimage;
+    wind->spare_extent = r->frame_extent;
+  }
+}
+
+void VG_CollectRetired(VGWindow * wind) {
+  if(wind->num_retired == 0)
+    return;
+  uint64_t done;
+  if(vkGetSemaphoreCounterValue(wind->device, wind->frame_timeline, &done) != VK_SUCCESS)
+    return;
+  int kept = 0;
+  for(int i = 0; i < wind->num_retired; i++) {
+    VGRetired * r = &wind->retired[i];
+    if(r->frame > done)
+      wind->retired[kept++] = *r;
+    else
+      VG_DestroyRetired(wind, r);
+  }
+  wind->num_retired = kept;
+}
+
+void VG_WaitFrame(VGWindow * wind, uint64_t frame) {
+  VkSemaphoreWaitInfo waitInfo = {
+    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+    .semaphoreCount = 1,
+    .pSemaphores = &wind->frame_timeline,
+    .pValues = &frame,
+  };
+  vkWaitSemaphores(wind->device, &waitInfo, UINT64_MAX);
+}
+
+uint32_t VG_NextFrame(VGWindow * wind) {
+  uint32_t slot = wind->frame_count % wind->frames_in_flight;
+  VG_WaitFrame(wind, wind->slot_frame[slot]);
+  VG_CollectRetired(wind);
+  wind->slot = slot;
+  wind->transient_used[slot] = 0;
+  return slot;
+}
+
+int VG_SubmitFrame(VGWindow * wind, uint32_t slot, VkCommandBuffer cmdbuf, VkPipelineStageFlags wait_stage) {
+  uint64_t frame = wind->frame_count + 1;
+  // the binary semaphores' values are ignored
+  uint64_t signalValues[] = { 0, frame };
+  VkSemaphore signalSemaphores[] = { wind->render_finished[slot], wind->frame_timeline };
+  // uploads taken over by this frame, already done by the time they're
+  // taken but the wait orders their queue's writes before it
+  uint64_t waitValues[] = { 0, wind->upload_wait };
+  VkSemaphore waitSemaphores[] = { wind->image_available[slot], wind->upload_timeline };
+  VkPipelineStageFlags waitStages[] = { wait_stage, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+  uint32_t waitCount = wind->upload_wait ? 2 : 1;
+  VkTimelineSemaphoreSubmitInfo timelineInfo = {
+    .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+    .waitSemaphoreValueCount = waitCount,
+    .pWaitSemaphoreValues = waitValues,
+    .signalSemaphoreValueCount = sizeof signalValues / sizeof *signalValues,
+    .pSignalSemaphoreValues = signalValues,
+  };
+  VkSubmitInfo submitInfo = {
+    .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+    .pNext = &timelineInfo,
+    .waitSemaphoreCount = waitCount,
+    .pWaitSemaphores = waitSemaphores,
+    .pWaitDstStageMask = waitStages,
+
+    .commandBufferCount = 1,
+    .pCommandBuffers = &cmdbuf,
+
+    .signalSemaphoreCount = sizeof signalSemaphores / sizeof *signalSemaphores,
+    .pSignalSemaphores = signalSemaphores,
+  };
+  if(vkQueueSubmit(wind->graphics_queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    return 1;
+  wind->frame_count = frame;
+  wind->slot_frame[slot] = frame;
+  wind->upload_wait = 0;
+  return 0;
+}
+
+int VG_SubmitUpload(VGWindow * wind, VkCommandBuffer cmdbuf, uint64_t * value) {
+  uint64_t upload = wind->upload_count + 1;
+  VkTimelineSemaphoreSubmitInfo timelineInfo = {
+    .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+    .signalSemaphoreValueCount = 1,
+    .pSignalSemaphoreValues = &upload,
+  };
+  VkSubmitInfo submitInfo = {
+    .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+    .pNext = &timelineInfo,
+    .commandBufferCount = 1,
+    .pCommandBuffers = &cmdbuf,
+    .signalSemaphoreCount = 1,
+    .pSignalSemaphores = &wind->upload_timeline,
+  };
+  if(vkQueueSubmit(wind->transfer_queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS)
+    return 1;
+  wind->upload_count = upload;
+  *value = upload;
+  return 0;
+}
+
+bool VG_UploadDone(VGWindow * wind, uint64_t value) {
+  uint64_t done;
+  return vkGetSemaphoreCounterValue(wind->device, wind->upload_timeline, &done) == VK_SUCCESS && done >= value;
+}
+
+void VG_TakeUpload(VGWindow * wind, uint64_t value) {
+  if(value > wind->upload_wait)
+    wind->upload_wait = value;
+}
+
+void VG_SetFramesInFlight(VGWindow * wind, uint32_t frames) {
+  VG_WaitFrame(wind, wind->frame_count);
+  wind->frames_in_flight = frames < 1 ? 1 : frames > VG_MAX_FRAMES ? VG_MAX_FRAMES : frames;
+}
+
 
 int VG_CreateSwapchain(VGWindow * wind) {
   VkSurfaceCapabilitiesKHR surface_caps;
@@ -528,16 +991,29 @@ int VG_CreateSwapchain(VGWindow * wind) {
 
   int w,h;
   SDL_Vulkan_GetDrawableSize(wind->window, &w, &h);
-  if(w == 0 || h == 0)
+  if(w == 0 || h == 0) {
+    if(wind->swapchain_created)
+      VG_RetireSwapchain(wind, false);
     return 0;
+  }
 
   VkExtent2D swap_extent = {
     .width = clampint(w, surface_caps.minImageExtent.width, surface_caps.maxImageExtent.width),
     .height = clampint(h, surface_caps.minImageExtent.height, surface_caps.maxImageExtent.height),
   };
   wind->swap_extent = swap_extent;
-  // guaranteed. no tearing. mailbox is higher power draw
+  // fifo is guaranteed and doesn't tear. mailbox and immediate get frames
+  // out sooner for more power, immediate tears too
   VkPresentModeKHR present_mode = VK_PRESENT_MODE_FIFO_KHR;
+  {
+    uint32_t modeCount;
+    vkGetPhysicalDeviceSurfacePresentModesKHR(wind->physical_device, wind->surface, &modeCount, NULL);
+    VkPresentModeKHR modes[modeCount];
+    vkGetPhysicalDeviceSurfacePresentModesKHR(wind->physical_device, wind->surface, &modeCount, modes);
+    for(uint32_t i = 0; i < modeCount; i++)
+      if(modes[i] == wind->present_mode)
+        present_mode = modes[i];
+  }
 
   uint32_t swapImageCount = surface_caps.minImageCount+1;
   if(surface_caps.maxImageCount && swapImageCount > surface_caps.maxImageCount)
@@ -557,7 +1033,8 @@ int VG_CreateSwapchain(VGWindow * wind) {
     .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
     .presentMode = present_mode,
     .clipped = VK_TRUE,
-    .oldSwapchain = VK_NULL_HANDLE,
+    // hands the old swapchain's images over instead of waiting for them
+    .oldSwapchain = wind->swapchain,
   };
 
   uint32_t queueFamilyIndices[] = { wind->graphics_queue_index, wind->present_queue_index };
@@ -567,10 +1044,22 @@ int VG_CreateSwapchain(VGWindow * wind) {
     swapCreateInfo.pQueueFamilyIndices = queueFamilyIndices;
   }
 
-  if(vkCreateSwapchainKHR(wind->device, &swapCreateInfo, NULL, &wind->swapchain) != VK_SUCCESS) {
+  // the old swapchain is retired by this even if it fails
+  VkSwapchainKHR swapchain;
+  VkResult created = vkCreateSwapchainKHR(wind->device, &swapCreateInfo, NULL, &swapchain);
+  VkExtent2D frame_extent = VG_FrameBucket(swap_extent);
+  bool same_frame = frame_extent.width == wind->frame_extent.width && frame_extent.height == wind->frame_extent.height;
+  if(wind->swapchain != VK_NULL_HANDLE)
+    VG_RetireSwapchain(wind, !same_frame);
+  else if(!same_frame && wind->primary_frameimage.img != VK_NULL_HANDLE) {
+    // nothing to retire it with, a minimize already took the swapchain
+    VG_RetireSwapchain(wind, true);
+  }
+  if(created != VK_SUCCESS) {
     fprintf(stderr, "failed to create swapchain\n");
     return 1;
   }
+  wind->swapchain = swapchain;
 
   vkGetSwapchainImagesKHR(wind->device, wind->swapchain, &swapImageCount, NULL);
   wind->num_swapimages = swapImageCount;
@@ -604,7 +1093,16 @@ int VG_CreateSwapchain(VGWindow * wind) {
     }
   }
 
-  wind->primary_frameimage = Create_PrimaryFrameimage(wind);
+  if(wind->primary_frameimage.img == VK_NULL_HANDLE) {
+    wind->frame_extent = frame_extent;
+    if(wind->spare_frameimage.img != VK_NULL_HANDLE &&
+       wind->spare_extent.width == frame_extent.width && wind->spare_extent.height == frame_extent.height) {
+      wind->primary_frameimage = wind->spare_frameimage;
+      wind->spare_frameimage = (VGImage) { VK_NULL_HANDLE };
+    } else {
+      wind->primary_frameimage = Create_PrimaryFrameimage(wind);
+    }
+  }
 
   {
     VkImageView attachments[] = {
@@ -632,24 +1130,30 @@ void VG_DestroySwapchain(VGWindow * wind) {
   VkDevice device = wind->device;
   vkDeviceWaitIdle(device);
 
-  vkDestroyFramebuffer(device, wind->primary_framebuffer, NULL);
-  for(int i = 0; i < wind->num_swapimages; i++)
-  {
-    vkDestroyImageView(device, wind->swapviews[i], NULL);
-  }
-  VG_DestroyImage(wind, wind->primary_frameimage);
-  vkDestroySwapchainKHR(device, wind->swapchain, NULL);
-
-  wind->swapchain_created = false;
+  VG_RetireSwapchain(wind, true);
+  for(int i = 0; i < wind->num_retired; i++)
+    VG_DestroyRetired(wind, &wind->retired[i]);
+  wind->num_retired = 0;
+  VG_DestroyImage(wind, wind->spare_frameimage);
+  wind->spare_frameimage = (VGImage) { VK_NULL_HANDLE };
 }
 
+// the old swapchain is handed to the new one and everything that goes with
+// it is destroyed later by VG_CollectRetired, nothing waits on the gpu
 int VG_RecreateSwapchain(VGWindow * wind) {
-  if(wind->swapchain_created)
-    VG_DestroySwapchain(wind);
-
+  VG_CollectRetired(wind);
   return VG_CreateSwapchain(wind);
 }
 
+int VG_SetPresentMode(VGWindow * wind, VkPresentModeKHR mode) {
+  if(mode == wind->present_mode)
+    return 0;
+  wind->present_mode = mode;
+  if(!wind->swapchain_created)
+    return 0;
+  return VG_RecreateSwapchain(wind);
+}
+
 void VG_WaitIdle(VGWindow * wind) {
   VkDevice device = wind->device;
   vkDeviceWaitIdle(device);
@@ -661,15 +1165,24 @@ void VG_DestroyWindow(VGWindow * wind) {
 
   VG_DestroySwapchain(wind);
 
-  for(int i = 0; i < 2; i++) {
+  for(int i = 0; i < VG_MAX_FRAMES; i++) {
     vkDestroySemaphore(device, wind->image_available[i], NULL);
     vkDestroySemaphore(device, wind->render_finished[i], NULL);
-    vkDestroyFence(device, wind->frame_fence[i], NULL);
   }
+  vkDestroySemaphore(device, wind->frame_timeline, NULL);
+  vkDestroySemaphore(device, wind->upload_timeline, NULL);
 
   vkDestroyCommandPool(device, wind->commandpool, NULL);
+  vkDestroyCommandPool(device, wind->transfer_pool, NULL);
 
   vkDestroyRenderPass(device, wind->renderpass, NULL);
+
+  for(int i = 0; i < wind->numblocks; i++)
+    VG_DestroyBlock(wind, wind->blocks[i]);
+  free(wind->blocks);
+  for(int i = 0; i < VG_MAX_FRAMES; i++)
+    VG_DestroyBlock(wind, wind->transient[i]);
+
   vkDestroyDevice(device, NULL);
   vkDestroySurfaceKHR(wind->instance, wind->surface, NULL);
   vkDestroyDebugUtilsMessengerEXT(wind->instance, wind->debug_mess, NULL);
@@ -677,8 +1190,6 @@ void VG_DestroyWindow(VGWindow * wind) {
 
   SDL_DestroyWindow(wind->window);
 
-  free(wind->swapviews);
-  free(wind->swapimages);
   free(wind);
 }
 
@@ -4,16 +4,46 @@
 #include "volk.h"
 #include <SDL2/SDL.h>
 
+// a vkAllocateMemory that buffers and images are carved out of. free has
+// the unused ranges sorted by offset. buffers and optimal images never share
+// a block, so bufferImageGranularity can't matter between neighbours
+typedef struct VGMemRange {
+  VkDeviceSize lo, hi;
+} VGMemRange;
+
+typedef struct VGMemBlock {
+  VkDeviceMemory mem;
+  VkDeviceSize size;
+  uint32_t type;
+  bool optimal;
+  // per frame slot blocks for transient buffers are only ever bumped along
+  // and emptied all at once
+  bool transient;
+  // mapped for good if the memory is host visible
+  void * map;
+  int numallocs;
+  int numfree;
+  int freesize;
+  VGMemRange * free;
+} VGMemBlock;
+
 typedef struct VGImage {
   VkImage img;
   VkDeviceMemory mem;
   VkImageView view;
+  VkDeviceSize size;
+  VGMemBlock * block;
+  VkDeviceSize offset;
 } VGImage;
 
+// map points at the buffer's memory when it is host visible
 typedef struct VGBuffer {
   VkBuffer buf;
   VkDeviceMemory mem;
   size_t size;
+  VGMemBlock * block;
+  VkDeviceSize offset;
+  void * map;
 } VGBuffer;
 
 typedef struct VGPipeline {
@@ -21,6 +51,28 @@ typedef struct VGPipeline {
   VkPipeline pipeline;
 } VGPipeline;
 
+// swapchain objects replaced by a resize, kept until the frames that were
+// in flight when it happened are done with them
+typedef struct VGRetired {
+  VkSwapchainKHR swapchain;
+  uint32_t num_swapimages;
+  VkImage * swapimages;
+  VkImageView * swapviews;
+  VkFramebuffer framebuffer;
+  VGImage frameimage;
+  VkExtent2D frame_extent;
+  // the last frame submitted before, which has to finish first
+  uint64_t frame;
+} VGRetired;
+
+enum { VG_MAX_RETIRED = 8 };
+
+// most frames that can be in flight, each has a slot of its own
+enum { VG_MAX_FRAMES = 4 };
+
+// blocks are allocated this big, anything over half of it gets one of its own
+enum { VG_MEM_BLOCK = 64 << 20 };
+
 typedef struct VGWindow {
   // Fundamental objects
   SDL_Window * window;
@@ -33,21 +85,54 @@ typedef struct VGWindow {
 
   uint32_t graphics_queue_index;
   uint32_t present_queue_index;
+  uint32_t transfer_queue_index;
 
   VkQueue graphics_queue;
   VkQueue present_queue;
+  // a transfer only queue and a pool for it, null if the device hasn't one
+  VkQueue transfer_queue;
+  VkCommandPool transfer_pool;
   uint32_t msaa_samples;
+  VkPhysicalDeviceMemoryProperties mem_props;
+  // multiDrawIndirect and drawIndirectFirstInstance, and drawIndirectCount
+  bool draw_indirect;
+  bool draw_indirect_count;
+
+  // every block but the transient ones
+  int numblocks;
+  int blockssize;
+  VGMemBlock ** blocks;
+  // the slot's transient block, how much of it this frame has used and the
+  // most it would have needed, which the block grows to next time around
+  uint32_t slot;
+  VGMemBlock * transient[VG_MAX_FRAMES];
+  VkDeviceSize transient_used[VG_MAX_FRAMES];
+  VkDeviceSize transient_want[VG_MAX_FRAMES];
 
   // Application objects
   VkSurfaceFormatKHR swapformat;
   VkRenderPass renderpass;
   VkCommandPool commandpool;
   
-  VkFence frame_fence[2];
-  VkSemaphore image_available[2];
-  VkSemaphore render_finished[2];
+  // frame_timeline is a timeline semaphore counting finished frames. frames
+  // are numbered from 1 in submission order, the last submitted being
+  // frame_count, and slot_frame has the last one each slot submitted
+  uint32_t frames_in_flight;
+  VkSemaphore frame_timeline;
+  uint64_t frame_count;
+  uint64_t slot_frame[VG_MAX_FRAMES];
+  VkSemaphore image_available[VG_MAX_FRAMES];
+  VkSemaphore render_finished[VG_MAX_FRAMES];
+
+  // counts the transfer queue's submits as they finish. the next frame
+  // waits for upload_wait, so what it takes over is ordered before it
+  VkSemaphore upload_timeline;
+  uint64_t upload_count;
+  uint64_t upload_wait;
 
   bool swapchain_created;
+  // asked for with VG_SetPresentMode, fifo is used when it isn't supported
+  VkPresentModeKHR present_mode;
   // Swapchain dependent objects
   VkExtent2D swap_extent;
   VkSwapchainKHR swapchain;
@@ -56,16 +141,25 @@ typedef struct VGWindow {
   VkImage * swapimages;
   VkImageView * swapviews;
 
+  // sized up to a whole bucket so most resizes can keep it, the spare is
+  // the last one given up, kept in case the window goes back to its size
   VGImage primary_frameimage;
+  VkExtent2D frame_extent;
+  VGImage spare_frameimage;
+  VkExtent2D spare_extent;
 
   VkFramebuffer primary_framebuffer;
 
+  int num_retired;
+  VGRetired retired[VG_MAX_RETIRED];
+
 } VGWindow;
 
 int VG_Init();
 void VG_Quit();
 
-VGWindow * VG_CreateWindow(int w, int h);
+// samples is the most msaa samples wanted, 1 for none
+VGWindow * VG_CreateWindow(int w, int h, uint32_t samples);
 void VG_DestroyWindow(VGWindow * wind);
 
 void VG_WaitIdle(VGWindow * wind);
@@ -73,9 +167,34 @@ void VG_WaitIdle(VGWindow * wind);
 int VG_CreateAppObjects(VGWindow * wind);
 int VG_CreateSwapchain(VGWindow * wind);
 int VG_RecreateSwapchain(VGWindow * wind);
+// switches the swapchain over to mode if the surface has it, fifo otherwise
+int VG_SetPresentMode(VGWindow * wind, VkPresentModeKHR mode);
+// frees what resizes left behind once the frames using it are done, cheap
+// enough to call every frame
+void VG_CollectRetired(VGWindow * wind);
+
+// waits until the next slot's last frame is done and returns the slot, whose
+// command buffer, image_available semaphore and so on can then be reused
+uint32_t VG_NextFrame(VGWindow * wind);
+// submits cmdbuf as the slot's frame, after its image_available and
+// signaling its render_finished for the present
+int VG_SubmitFrame(VGWindow * wind, uint32_t slot, VkCommandBuffer cmdbuf, VkPipelineStageFlags wait_stage);
+// waits for every frame, then allows this many at a time
+void VG_SetFramesInFlight(VGWindow * wind, uint32_t frames);
+void VG_WaitFrame(VGWindow * wind, uint64_t frame);
+
+// submits cmdbuf on the transfer queue. value is what upload_timeline will
+// reach when it's done, for VG_UploadDone and VG_TakeUpload
+int VG_SubmitUpload(VGWindow * wind, VkCommandBuffer cmdbuf, uint64_t * value);
+bool VG_UploadDone(VGWindow * wind, uint64_t value);
+// the next frame submitted waits for the upload first
+void VG_TakeUpload(VGWindow * wind, uint64_t value);
 
 // yucky
 VGBuffer VG_CreateBufferImpl(VGWindow * wind, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags props);
+// host visible and coherent, gone once the current frame slot comes round
+// again. VG_DestroyBuffer still has to be called on it before then
+VGBuffer VG_CreateTransientBuffer(VGWindow * wind, VkDeviceSize size, VkBufferUsageFlags usage);
 void VG_DestroyBuffer(VGWindow * wind, VGBuffer buf);
 
 VGImage VG_CreateImageImpl(VGWindow * wind, uint32_t w, uint32_t h, uint32_t levels, VkSampleCountFlagBits num_samples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags props);